@@ -0,0 +1,148 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+// Measures what the embedding API costs a host allocator. Threads call
+// mwf_record() as fast as they can while another thread drains finished
+// columns like a host would, then the drained counts are checked against the
+// number of calls. A second pass passes the time in with mwf_record_at() to
+// separate the cost of reading the clock.
+
+#include "EmbedApi.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Returns false if the drained counts do not add up.
+static bool RunPass(const char *name, bool hostTime, size_t eventsPerThread, int numThreads)
+{
+  constexpr double ColumnMs = 10.0;
+  constexpr double LateMs = 100.0;
+  mwf_histogram *histogram = mwf_create(ColumnMs, 4096, LateMs);
+
+  std::atomic<bool> producing = true;
+  uint64_t drained = 0;
+  auto drainOnce = [&]() {
+    mwf_drain(
+        histogram,
+        [](void *userData, int64_t, const uint32_t *counts, int numSizeBuckets) {
+          for (int i = 0; i < numSizeBuckets; ++i) {
+            *static_cast<uint64_t *>(userData) += counts[i];
+          }
+        },
+        &drained);
+  };
+  std::thread drainer([&]() {
+    while (producing) {
+      drainOnce();
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }
+  });
+
+  std::vector<double> recordSeconds(numThreads, 0.0);
+  std::vector<std::thread> producers;
+  for (int t = 0; t < numThreads; ++t) {
+    producers.emplace_back([&, t]() {
+      // Sizes are generated up front so that only the calls are timed
+      std::mt19937_64 random(t);
+      std::uniform_real_distribution<double> logSize(3.0, 20.0);
+      std::vector<size_t> sizes(64 * 1024);
+      for (size_t &size : sizes) {
+        size = size_t(std::exp2(logSize(random)));
+      }
+
+      double timeMs = 0.0;
+      const Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < eventsPerThread; ++i) {
+        const size_t size = sizes[i & (sizes.size() - 1)];
+        if (hostTime) {
+          // Like a host with its own coarse clock: one reading per 1024 calls
+          if ((i & 1023) == 0) {
+            timeMs = mwf_elapsed_ms(histogram);
+          }
+          mwf_record_at(histogram, timeMs, size);
+        }
+        else {
+          mwf_record(histogram, size);
+        }
+      }
+      recordSeconds[size_t(t)] = SecondsSince(start);
+    });
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  producing = false;
+  drainer.join();
+
+  // Let the last columns finish, then take them
+  std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(LateMs + 2 * ColumnMs));
+  drainOnce();
+
+  mwf_stats stats;
+  mwf_get_stats(histogram, &stats);
+  mwf_destroy(histogram);
+
+  double slowest = 0.0;
+  double totalSeconds = 0.0;
+  for (const double seconds : recordSeconds) {
+    slowest = std::max(slowest, seconds);
+    totalSeconds += seconds;
+  }
+  const uint64_t recorded = uint64_t(eventsPerThread) * uint64_t(numThreads);
+  std::printf("%-10s %.1f ns per call, %.1f M events/s over %d threads, "
+              "%llu drained, %llu dropped\n",
+              name,
+              totalSeconds * 1e9 / double(recorded),
+              double(recorded) / slowest / 1e6,
+              numThreads,
+              static_cast<unsigned long long>(drained),
+              static_cast<unsigned long long>(stats.dropped_events));
+
+  return stats.total_allocations == recorded && drained + stats.dropped_events == recorded;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t numEvents = 100'000'000;
+  int numThreads = int(std::max(1u, std::thread::hardware_concurrency()));
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool haveValue = i + 1 < argc;
+    if (arg == "--events" && haveValue) {
+      numEvents = size_t(std::max(1ll, std::atoll(argv[++i])));
+    }
+    else if (arg == "--threads" && haveValue) {
+      numThreads = std::max(1, std::atoi(argv[++i]));
+    }
+    else {
+      std::fprintf(stderr, "Usage: %s [--events N] [--threads N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const size_t eventsPerThread = numEvents / size_t(numThreads);
+  const bool clockOk = RunPass("record", false, eventsPerThread, numThreads);
+  const bool hostOk = RunPass("record_at", true, eventsPerThread, numThreads);
+  if (!clockOk || !hostOk) {
+    std::fprintf(stderr, "Drained counts do not match the number of calls\n");
+    return 1;
+  }
+  return 0;
+}
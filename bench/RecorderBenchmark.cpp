@@ -0,0 +1,145 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+// Measures what recording costs a live capture and how fast the recorder
+// writes. Producer threads append synthetic events as fast as they can, either
+// one at a time like the ETW callback or in batches like the replay and socket
+// sources. The file is then parsed again to check that it reopens intact.
+
+#include "CSVDataSource.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+  std::filesystem::path filePath = "recorder-benchmark.csv";
+  size_t numEvents = 20'000'000;
+  int numThreads = 4;
+  size_t batchSize = 1;
+  bool keep = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool haveValue = i + 1 < argc;
+    if (arg == "--file" && haveValue) {
+      filePath = argv[++i];
+    }
+    else if (arg == "--events" && haveValue) {
+      numEvents = size_t(std::max(1ll, std::atoll(argv[++i])));
+    }
+    else if (arg == "--threads" && haveValue) {
+      numThreads = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (arg == "--batch" && haveValue) {
+      batchSize = size_t(std::max(1, std::atoi(argv[++i])));
+    }
+    else if (arg == "--keep") {
+      keep = true;
+    }
+    else {
+      std::fprintf(stderr,
+                   "Usage: %s [--file PATH] [--events N] [--threads N] [--batch N] [--keep]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  TraceRecorder recorder(filePath);
+  if (!recorder.open()) {
+    return 1;
+  }
+
+  const size_t eventsPerThread = numEvents / size_t(numThreads);
+  std::vector<double> appendSeconds(numThreads, 0.0);
+  std::vector<std::thread> producers;
+
+  const Clock::time_point start = Clock::now();
+  for (int t = 0; t < numThreads; ++t) {
+    producers.emplace_back([&, t]() {
+      std::mt19937_64 random(t);
+      std::uniform_real_distribution<double> logSize(3.0, 20.0);
+
+      AllocationEvents batch(batchSize);
+      double timeMs = 0.0;
+      double spentSeconds = 0.0;
+      for (size_t sent = 0; sent < eventsPerThread; sent += batchSize) {
+        const size_t count = std::min(batchSize, eventsPerThread - sent);
+        for (size_t i = 0; i < count; ++i) {
+          timeMs += 0.0001;
+          batch[i] = AllocationEvent{timeMs, size_t(std::exp2(logSize(random)))};
+        }
+
+        const Clock::time_point appendStart = Clock::now();
+        recorder.append(batch.data(), count);
+        spentSeconds += SecondsSince(appendStart);
+      }
+      appendSeconds[size_t(t)] = spentSeconds;
+    });
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  const double produceSeconds = SecondsSince(start);
+
+  const Clock::time_point closeStart = Clock::now();
+  recorder.close();
+  const double closeSeconds = SecondsSince(closeStart);
+  const double totalSeconds = SecondsSince(start);
+
+  if (recorder.failed()) {
+    std::fprintf(stderr, "Writing %s failed\n", filePath.string().c_str());
+    return 1;
+  }
+
+  double appendTotal = 0.0;
+  for (const double seconds : appendSeconds) {
+    appendTotal += seconds;
+  }
+  const size_t written = recorder.eventsWritten();
+  std::printf("append: %.1f ns per event (%d threads, batches of %zu)\n",
+              appendTotal * 1e9 / double(eventsPerThread * size_t(numThreads)),
+              numThreads,
+              batchSize);
+  std::printf("write:  %zu events, %.1f MB in %.2f s: %.2f M events/s, %.1f MB/s "
+              "(%.2f s producing, %.2f s draining on close)\n",
+              written,
+              double(recorder.bytesWritten()) / 1e6,
+              totalSeconds,
+              double(written) / totalSeconds / 1e6,
+              double(recorder.bytesWritten()) / totalSeconds / 1e6,
+              produceSeconds,
+              closeSeconds);
+
+  const Clock::time_point readStart = Clock::now();
+  size_t readBack = 0;
+  CSVDataSource(filePath).readChunks(CSVDataSource::ChunkSize, [&](const AllocationEvents &chunk) {
+    readBack += chunk.size();
+    return true;
+  });
+  std::printf("reopen: %zu events parsed in %.2f s\n", readBack, SecondsSince(readStart));
+
+  if (!keep) {
+    std::filesystem::remove(filePath);
+  }
+
+  return readBack == written ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "BurstDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// Beyond this many empty columns every average has decayed to nothing anyway
+constexpr int64_t MAX_DECAY_COLUMNS = 4096;
+
+BurstDetector::BurstDetector(double originMs,
+                             double columnMs,
+                             const Options &options,
+                             int numSizeBuckets)
+    : originMs_(originMs), columnMs_(columnMs), options_(options), buckets_(numSizeBuckets)
+{
+}
+
+int BurstDetector::addColumn(int64_t column, const uint32_t *counts)
+{
+  if (column <= lastColumn_) {
+    return 0;
+  }
+  if (lastColumn_ >= 0) {
+    decay(std::min(column - lastColumn_ - 1, MAX_DECAY_COLUMNS));
+  }
+
+  const bool warm = numColumns_ >= options_.warmupColumns;
+  const double alpha = options_.alpha;
+  const double timeMs = originMs_ + double(column) * columnMs_;
+
+  int numStarted = 0;
+  for (int s = 0; s < int(buckets_.size()); ++s) {
+    BucketState &state = buckets_[s];
+    const double count = counts[s];
+
+    // Counts are never steadier than a Poisson process, which keeps a very
+    // regular bucket from flagging every small wobble.
+    const double deviation = std::max(std::sqrt(state.variance),
+                                      std::sqrt(std::max(state.mean, 1.0)));
+
+    if (state.inBurst) {
+      if (count <= state.mean + 0.5 * options_.threshold * deviation) {
+        state.inBurst = false;
+      }
+      else if (Bookmark *bookmark = findBookmark(state.bookmark)) {
+        bookmark->durationMs = timeMs + columnMs_ - bookmark->timeMs;
+        bookmark->peakCount = std::max(bookmark->peakCount, counts[s]);
+      }
+    }
+    else if (warm && counts[s] >= options_.minCount &&
+             count > state.mean + options_.threshold * deviation)
+    {
+      state.inBurst = true;
+      state.bookmark = numBookmarks_++;
+      bookmarks_.push_back(Bookmark{timeMs, columnMs_, s, counts[s], counts[s], state.mean});
+      if (bookmarks_.size() > MaxBookmarks) {
+        bookmarks_.pop_front();
+      }
+      ++numStarted;
+    }
+
+    const double difference = count - state.mean;
+    const double increment = alpha * difference;
+    state.mean += increment;
+    state.variance = (1.0 - alpha) * (state.variance + difference * increment);
+  }
+
+  lastColumn_ = column;
+  ++numColumns_;
+  return numStarted;
+}
+
+void BurstDetector::decay(int64_t numEmptyColumns)
+{
+  const double alpha = options_.alpha;
+  for (BucketState &state : buckets_) {
+    state.inBurst = state.inBurst && numEmptyColumns == 0;
+    for (int64_t i = 0; i < numEmptyColumns && state.mean > 0.0; ++i) {
+      state.variance = (1.0 - alpha) * (state.variance + alpha * state.mean * state.mean);
+      state.mean *= 1.0 - alpha;
+    }
+  }
+  numColumns_ += numEmptyColumns;
+}
+
+Bookmark *BurstDetector::findBookmark(uint64_t sequence)
+{
+  const uint64_t firstSequence = numBookmarks_ - bookmarks_.size();
+  if (sequence < firstSequence) {
+    return nullptr;
+  }
+  return &bookmarks_[size_t(sequence - firstSequence)];
+}
+
+bool ExportBookmarks(const std::filesystem::path &filePath,
+                     const Bookmarks &bookmarks,
+                     const SizeBucketScheme &sizes)
+{
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file: %s\n", filePath.string().c_str());
+    return false;
+  }
+
+  // The last size bucket has no upper bound, so its max_bytes is left empty
+  std::string text =
+      "time_ms, duration_ms, size_bucket, min_bytes, max_bytes, count, peak_count, baseline\n";
+  char maxBytes[24];
+  char line[192];
+  for (const Bookmark &bookmark : bookmarks) {
+    if (bookmark.sizeBucket + 1 < sizes.size()) {
+      std::snprintf(maxBytes, sizeof(maxBytes), "%zu", sizes.limits()[bookmark.sizeBucket]);
+    }
+    else {
+      maxBytes[0] = '\0';
+    }
+    const int length = std::snprintf(line,
+                                     sizeof(line),
+                                     "%.3f, %.3f, %d, %zu, %s, %u, %u, %.2f\n",
+                                     bookmark.timeMs,
+                                     bookmark.durationMs,
+                                     bookmark.sizeBucket,
+                                     sizes.minBytes(bookmark.sizeBucket),
+                                     maxBytes,
+                                     bookmark.count,
+                                     bookmark.peakCount,
+                                     bookmark.baseline);
+    text.append(line, size_t(length));
+  }
+
+  file.write(text.data(), std::streamsize(text.size()));
+  file.close();
+  return bool(file);
+}
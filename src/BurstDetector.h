@@ -0,0 +1,104 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "SizeBuckets.h"
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <vector>
+
+// A burst of allocations in one size bucket.
+struct Bookmark {
+  double timeMs = 0.0;
+  double durationMs = 0.0;
+  int sizeBucket = 0;
+  // Count of the first column of the burst and the largest count during it
+  uint32_t count = 0;
+  uint32_t peakCount = 0;
+  // Expected count per column when the burst started
+  double baseline = 0.0;
+};
+
+using Bookmarks = std::deque<Bookmark>;
+
+// Streaming burst detection over finished histogram columns. Every size bucket
+// keeps an exponentially weighted moving average and variance of its count
+// per column. A column more than `threshold` deviations above the average
+// starts a burst, which lasts until the count falls back below half that
+// margin. Work is per column, never per event.
+class BurstDetector {
+ public:
+  static constexpr int NumSizeBuckets = int(SIZE_BUCKETS.size());
+  static constexpr double DefaultThreshold = 4.0;
+  // Oldest bookmarks are dropped beyond this
+  static constexpr size_t MaxBookmarks = 64 * 1024;
+
+  struct Options {
+    // Weight of the newest column in the moving average
+    double alpha = 0.02;
+    double threshold = DefaultThreshold;
+    // Counts below this are never a burst, however quiet the bucket was
+    uint32_t minCount = 8;
+    // Columns to learn the baseline from before reporting anything
+    int warmupColumns = 64;
+  };
+
+  BurstDetector() = default;
+  BurstDetector(double originMs,
+                double columnMs,
+                const Options &options,
+                int numSizeBuckets = NumSizeBuckets);
+
+  // Feeds the counts of `column`, which covers originMs + column * columnMs
+  // onwards, one per size bucket. Columns must arrive in increasing order;
+  // skipped columns count as empty. Returns the number of bursts that started.
+  int addColumn(int64_t column, const uint32_t *counts);
+
+  const Bookmarks &bookmarks() const
+  {
+    return bookmarks_;
+  }
+  // Next column expected, i.e. one past the last column fed
+  int64_t nextColumn() const
+  {
+    return lastColumn_ + 1;
+  }
+  double columnMs() const
+  {
+    return columnMs_;
+  }
+  const Options &options() const
+  {
+    return options_;
+  }
+
+ private:
+  struct BucketState {
+    double mean = 0.0;
+    double variance = 0.0;
+    bool inBurst = false;
+    // Sequence number of the bookmark of the current burst
+    uint64_t bookmark = 0;
+  };
+
+  void decay(int64_t numEmptyColumns);
+  Bookmark *findBookmark(uint64_t sequence);
+
+  double originMs_ = 0.0;
+  double columnMs_ = 1.0;
+  Options options_;
+  std::vector<BucketState> buckets_ = std::vector<BucketState>(NumSizeBuckets);
+  int64_t lastColumn_ = -1;
+  int64_t numColumns_ = 0;
+  Bookmarks bookmarks_;
+  uint64_t numBookmarks_ = 0;
+};
+
+// Writes bookmarks as CSV with a header line, one burst per line. `sizes` is
+// the scheme the bursts were detected with.
+bool ExportBookmarks(const std::filesystem::path &filePath,
+                     const Bookmarks &bookmarks,
+                     const SizeBucketScheme &sizes = SizeBucketScheme::Default());
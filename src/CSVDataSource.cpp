@@ -3,37 +3,161 @@
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #include "CSVDataSource.h"
 
-#include <QDebug>
-#include <QFile>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
 
-CSVDataSource::CSVDataSource(const QString &filePath) : filePath_(filePath) {}
+static const char *SkipBlanks(const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    ++p;
+  }
+  return p;
+}
+
+// Parses a single "time, size" line. Anything else is rejected.
+static bool ParseLine(const char *p, const char *end, AllocationEvent &event)
+{
+  while (end > p && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+    --end;
+  }
+
+  p = SkipBlanks(p, end);
+  auto [timeEnd, timeError] = std::from_chars(p, end, event.timeMs);
+  if (timeError != std::errc()) {
+    return false;
+  }
+
+  p = SkipBlanks(timeEnd, end);
+  if (p == end || *p != ',') {
+    return false;
+  }
+
+  p = SkipBlanks(p + 1, end);
+  unsigned long long size = 0;
+  auto [sizeEnd, sizeError] = std::from_chars(p, end, size);
+  if (sizeError != std::errc() || sizeEnd != end) {
+    return false;
+  }
+
+  event.size = size_t(size);
+  return true;
+}
+
+CSVDataSource::CSVDataSource(const std::filesystem::path &filePath) : filePath_(filePath) {}
 
 AllocationEvents CSVDataSource::loadData() const
 {
   AllocationEvents events;
 
-  QFile file(filePath_);
-  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    qWarning() << "Failed to open file:" << filePath_;
-    return events;
+  readChunks(ChunkSize, [&events](const AllocationEvents &chunk) {
+    events.insert(events.end(), chunk.begin(), chunk.end());
+    return true;
+  });
+
+  return events;
+}
+
+bool CSVDataSource::readChunks(size_t chunkSize,
+                               const ChunkCallback &fn,
+                               std::atomic<int64_t> *bytesRead) const
+{
+  return readRange(0, std::numeric_limits<int64_t>::max(), chunkSize, fn, bytesRead);
+}
+
+bool CSVDataSource::readRange(int64_t firstByte,
+                              int64_t lastByte,
+                              size_t chunkSize,
+                              const ChunkCallback &fn,
+                              std::atomic<int64_t> *bytesRead) const
+{
+  std::ifstream file(filePath_, std::ios::binary);
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file: %s\n", filePath_.string().c_str());
+    return false;
   }
 
-  QTextStream in(&file);
-  while (!in.atEnd()) {
-    QString line = in.readLine();
-    QStringList parts = line.split(',');
+  // A range that does not start the file begins with the rest of the line
+  // before it, which belongs to the previous range. Starting one byte early
+  // makes that skipped part end at the newline just before firstByte.
+  int64_t offset = 0;
+  bool skipLine = false;
+  if (firstByte > 0) {
+    offset = firstByte - 1;
+    skipLine = true;
+    file.seekg(offset);
+  }
+
+  // Read in large blocks and parse lines in place. A partial line at the end
+  // of a block is moved to the front of the buffer before the next read.
+  constexpr size_t BlockSize = 4 * 1024 * 1024;
+  std::vector<char> buffer(BlockSize);
+  size_t carry = 0;
+
+  AllocationEvents chunk;
+  chunk.reserve(chunkSize);
+
+  auto parseLine = [&](const char *begin, const char *end) {
+    AllocationEvent event;
+    if (ParseLine(begin, end, event)) {
+      chunk.push_back(event);
+    }
+  };
+
+  bool keepGoing = true;
+  bool rangeDone = false;
+  while (keepGoing && !rangeDone) {
+    if (carry == buffer.size()) {
+      buffer.resize(buffer.size() * 2);
+    }
+
+    file.read(buffer.data() + carry, std::streamsize(buffer.size() - carry));
+    const std::streamsize blockBytes = file.gcount();
+    if (blockBytes <= 0) {
+      if (carry > 0 && !skipLine && offset < lastByte) {
+        parseLine(buffer.data(), buffer.data() + carry);
+      }
+      break;
+    }
 
-    if (parts.size() == 2) {
-      bool ok1, ok2;
-      double timeMs = parts[0].toDouble(&ok1);
-      size_t size = parts[1].toULongLong(&ok2);
+    const char *p = buffer.data();
+    const char *end = buffer.data() + carry + blockBytes;
+    if (bytesRead) {
+      *bytesRead += blockBytes;
+    }
+    while (const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p))) {
+      if (skipLine) {
+        skipLine = false;
+      }
+      else if (offset + (p - buffer.data()) >= lastByte) {
+        // The rest belongs to the next range
+        rangeDone = true;
+        break;
+      }
+      else {
+        parseLine(p, newline);
+      }
+      p = newline + 1;
 
-      if (ok1 && ok2) {
-        events.push_back({timeMs, size});
+      if (chunk.size() >= chunkSize) {
+        keepGoing = fn(chunk);
+        chunk.clear();
+        if (!keepGoing) {
+          break;
+        }
       }
     }
+
+    offset += p - buffer.data();
+    carry = size_t(end - p);
+    std::memmove(buffer.data(), p, carry);
   }
 
-  file.close();
-  return events;
+  if (keepGoing && !chunk.empty()) {
+    keepGoing = fn(chunk);
+  }
+
+  return keepGoing;
 }
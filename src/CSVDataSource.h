@@ -5,13 +5,36 @@
 
 #include "DataSource.h"
 
-#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 
 class CSVDataSource {
  public:
-  explicit CSVDataSource(const QString &filePath);
+  // Return false from the callback to stop reading early.
+  using ChunkCallback = std::function<bool(const AllocationEvents &chunk)>;
+
+  static constexpr size_t ChunkSize = 64 * 1024;
+
+  explicit CSVDataSource(const std::filesystem::path &filePath);
   AllocationEvents loadData() const;
 
+  // Parses the file in order, handing over at most `chunkSize` events at a time.
+  // The number of bytes consumed so far is added to `bytesRead` when given.
+  // Returns false if the file could not be opened or reading was stopped.
+  bool readChunks(size_t chunkSize,
+                  const ChunkCallback &fn,
+                  std::atomic<int64_t> *bytesRead = nullptr) const;
+
+  // Like readChunks, but only parses the lines that start within
+  // [firstByte, lastByte), so that several threads can split one file.
+  bool readRange(int64_t firstByte,
+                 int64_t lastByte,
+                 size_t chunkSize,
+                 const ChunkCallback &fn,
+                 std::atomic<int64_t> *bytesRead = nullptr) const;
+
  private:
-  QString filePath_;
+  std::filesystem::path filePath_;
 };
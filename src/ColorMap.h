@@ -0,0 +1,73 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+struct ColorRgb {
+  uint8_t r = 0;
+  uint8_t g = 0;
+  uint8_t b = 0;
+};
+
+// Viridis colormap
+constexpr int NUM_COLORS = 400;
+constexpr std::array<ColorRgb, NUM_COLORS + 1> COLOR_MAP = []() {
+  std::array<ColorRgb, NUM_COLORS + 1> map;
+  for (int i = 0; i <= NUM_COLORS; ++i) {
+    const double t = i / double(NUM_COLORS);
+
+    double r = 0;
+    double g = 0;
+    double b = 0;
+
+    if (t < 0.5) {
+      r = 0.267004 + 2 * t * (0.127568 - 0.267004);
+      g = 0.004874 + 2 * t * (0.566949 - 0.004874);
+      b = 0.329415 + 2 * t * (0.550556 - 0.329415);
+    }
+    else {
+      const double t2 = 2 * (t - 0.5);
+      r = 0.127568 + t2 * (0.993248 - 0.127568);
+      g = 0.566949 + t2 * (0.906157 - 0.566949);
+      b = 0.550556 + t2 * (0.143936 - 0.550556);
+    }
+
+    map[i] = ColorRgb{uint8_t(r * 255), uint8_t(g * 255), uint8_t(b * 255)};
+  }
+  return map;
+}();
+
+// Diverging colormap for compare mode, indexed by (delta + NUM_DIFF_COLORS).
+// Fewer allocations than the baseline fade from black to blue, more fade from
+// black to red, so cells without a difference blend into the background.
+constexpr int NUM_DIFF_COLORS = 100;
+constexpr std::array<ColorRgb, 2 * NUM_DIFF_COLORS + 1> DIFF_COLOR_MAP = []() {
+  std::array<ColorRgb, 2 * NUM_DIFF_COLORS + 1> map;
+  for (int i = -NUM_DIFF_COLORS; i <= NUM_DIFF_COLORS; ++i) {
+    // Ease-out ramp so that small differences are still visible
+    const double linear = (i < 0 ? -i : i) / double(NUM_DIFF_COLORS);
+    const double t = 1.0 - (1.0 - linear) * (1.0 - linear);
+
+    if (i < 0) {
+      map[i + NUM_DIFF_COLORS] = ColorRgb{uint8_t(t * 64), uint8_t(t * 140), uint8_t(t * 255)};
+    }
+    else {
+      map[i + NUM_DIFF_COLORS] = ColorRgb{uint8_t(t * 255), uint8_t(t * 72), uint8_t(t * 48)};
+    }
+  }
+  return map;
+}();
+
+constexpr ColorRgb GetColorForCount(int count)
+{
+  return COLOR_MAP[std::clamp(count, 0, NUM_COLORS)];
+}
+
+constexpr ColorRgb GetColorForDelta(int delta)
+{
+  return DIFF_COLOR_MAP[std::clamp(delta, -NUM_DIFF_COLORS, NUM_DIFF_COLORS) + NUM_DIFF_COLORS];
+}
@@ -3,6 +3,9 @@
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 struct AllocationEvent {
@@ -19,3 +22,63 @@ struct AllocationStats {
 };
 
 using AllocationEvents = std::vector<AllocationEvent>;
+
+// Index of the trace each event came from, parallel to AllocationEvents, when
+// several traces are merged into one stream.
+using AllocationSources = std::vector<uint16_t>;
+
+// Small index of the calling thread, handed out in order of first use, for
+// spreading recording threads over shards. Both variables are constant
+// initialized, so the first call on a thread runs no initializer and does not
+// allocate; zero means not assigned yet.
+inline unsigned ThreadShardIndex()
+{
+  constinit static std::atomic<unsigned> nextIndex = 1;
+  constinit thread_local unsigned index = 0;
+  if (index == 0) {
+    index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+  }
+  return index;
+}
+
+class LiveHistogram;
+class TraceRecorder;
+
+// A source of allocation events that arrive while the viewer is running.
+class LiveDataSource {
+ public:
+  virtual ~LiveDataSource() = default;
+
+  virtual bool start() = 0;
+  virtual void stop() = 0;
+  virtual bool isRunning() const = 0;
+
+  // Milliseconds since the first event, on the same clock as the event times.
+  virtual double getElapsedTimeMs() const = 0;
+
+  // Returns the events from the last `maxAgeMs`. Unused while a histogram is set.
+  virtual void getRecentEvents(double maxAgeMs, AllocationEvents &recent) const = 0;
+
+  // How long after the fact events may still arrive. Time buckets are only
+  // treated as finished once this has passed.
+  virtual double lateEventsMs() const = 0;
+
+  // When set, events are binned straight into `histogram` as they arrive and
+  // raw events are no longer kept. Must only be changed while stopped.
+  void setHistogram(LiveHistogram *histogram)
+  {
+    histogram_ = histogram;
+  }
+
+  // When set, events are also appended to `recorder` as they arrive, whether
+  // or not they are aggregated. May be set while running, but the recorder
+  // must outlive the capture.
+  void setRecorder(TraceRecorder *recorder)
+  {
+    recorder_.store(recorder, std::memory_order_release);
+  }
+
+ protected:
+  LiveHistogram *histogram_ = nullptr;
+  std::atomic<TraceRecorder *> recorder_ = nullptr;
+};
@@ -2,6 +2,8 @@
  *
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #include "ETWDataSource.h"
+#include "LiveHistogram.h"
+#include "TraceRecorder.h"
 
 #include <QDebug>
 
@@ -13,6 +15,8 @@
 
 QMutex ETWDataSource::dataMutex_;
 AllocationEvents ETWDataSource::events_;
+LiveHistogram *ETWDataSource::sessionHistogram_ = nullptr;
+std::atomic<TraceRecorder *> *ETWDataSource::sessionRecorder_ = nullptr;
 LARGE_INTEGER ETWDataSource::startTime_;
 LARGE_INTEGER ETWDataSource::frequency_;
 double ETWDataSource::firstTimestampMs_ = 0.0;
@@ -95,7 +99,20 @@ void WINAPI ETWDataSource::EventRecordCallback(PEVENT_RECORD pEvent)
                                    (absoluteTimestampMs - firstTimestampMs_) :
                                    0.0;
 
-    events_.push_back(AllocationEvent{timestampMs, allocSizeU64});
+    const AllocationEvent event{timestampMs, allocSizeU64};
+    if (sessionHistogram_) {
+      // The histogram is safe to update concurrently, so don't hold the lock
+      locker.unlock();
+      sessionHistogram_->record(timestampMs, allocSizeU64);
+    }
+    else {
+      events_.push_back(event);
+      locker.unlock();
+    }
+
+    if (TraceRecorder *recorder = sessionRecorder_->load(std::memory_order_acquire)) {
+      recorder->append(&event, 1);
+    }
   }
 
   if (pInfo != (PTRACE_EVENT_INFO)pInfoBuffer) {
@@ -185,6 +202,8 @@ bool ETWDataSource::start()
 
   shouldStop_ = false;
   haveFirstTimestamp_ = false;
+  sessionHistogram_ = histogram_;
+  sessionRecorder_ = &recorder_;
 
   {
     QMutexLocker locker(&dataMutex_);
@@ -217,6 +236,7 @@ void ETWDataSource::stop()
   }
 
   cleanupSession();
+  sessionHistogram_ = nullptr;
   running_ = false;
 
   qDebug() << "ETW tracing stopped";
@@ -13,25 +13,32 @@
 
 #include <evntrace.h>
 
+#include <atomic>
 #include <thread>
 
-class ETWDataSource : public QObject {
+class ETWDataSource : public QObject, public LiveDataSource {
   Q_OBJECT
 
  public:
   explicit ETWDataSource(QObject *parent = nullptr);
   ~ETWDataSource() final;
 
-  bool start();
-  void stop();
-  bool isRunning() const
+  bool start() final;
+  void stop() final;
+  bool isRunning() const final
   {
     return running_;
   }
 
-  double getElapsedTimeMs() const;
+  double getElapsedTimeMs() const final;
 
-  void getRecentEvents(double maxAgeMs, AllocationEvents &recent) const;
+  void getRecentEvents(double maxAgeMs, AllocationEvents &recent) const final;
+
+  // ETW hands events over in buffers that are flushed about once a second
+  double lateEventsMs() const final
+  {
+    return 1000.0;
+  }
 
  signals:
   void errorOccurred(const QString &error);
@@ -49,6 +56,10 @@ class ETWDataSource : public QObject {
 
   static QMutex dataMutex_;
   static AllocationEvents events_;
+  // Copy of histogram_ for the static callback, set for the duration of a session
+  static LiveHistogram *sessionHistogram_;
+  // recorder_ of the running instance
+  static std::atomic<TraceRecorder *> *sessionRecorder_;
   static LARGE_INTEGER startTime_;
   static LARGE_INTEGER frequency_;
   static double firstTimestampMs_;
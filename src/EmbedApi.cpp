@@ -0,0 +1,139 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "EmbedApi.h"
+#include "LiveHistogram.h"
+#include "SizeBuckets.h"
+#include "TraceRecorder.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+struct mwf_histogram {
+  mwf_histogram(double columnMs, int numColumns, double lateMs)
+      : histogram(columnMs, numColumns, lateMs)
+  {
+  }
+
+  double elapsedMs() const
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime)
+        .count();
+  }
+
+  void record(double timeMs, size_t size)
+  {
+    histogram.record(timeMs, size);
+    if (TraceRecorder *current = recorder.load(std::memory_order_acquire)) {
+      const AllocationEvent event{timeMs, size};
+      current->append(&event, 1);
+    }
+  }
+
+  LiveHistogram histogram;
+  const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+  std::atomic<TraceRecorder *> recorder = nullptr;
+  // Stopped recorders are kept until destruction since a recording thread may
+  // still be appending to one. Appends after close() are ignored.
+  std::mutex recordersMutex;
+  std::vector<std::unique_ptr<TraceRecorder>> recorders;
+};
+
+mwf_histogram *mwf_create(double column_ms, int num_columns, double late_ms)
+{
+  if (!(column_ms > 0.0) || num_columns <= 0) {
+    return nullptr;
+  }
+  return new (std::nothrow) mwf_histogram(column_ms, num_columns, late_ms);
+}
+
+void mwf_destroy(mwf_histogram *histogram)
+{
+  if (!histogram) {
+    return;
+  }
+  mwf_stop_recording(histogram);
+  delete histogram;
+}
+
+void mwf_record(mwf_histogram *histogram, size_t size)
+{
+  histogram->record(histogram->elapsedMs(), size);
+}
+
+void mwf_record_at(mwf_histogram *histogram, double time_ms, size_t size)
+{
+  histogram->record(time_ms, size);
+}
+
+double mwf_elapsed_ms(const mwf_histogram *histogram)
+{
+  return histogram->elapsedMs();
+}
+
+int mwf_drain(mwf_histogram *histogram, mwf_column_fn fn, void *user_data)
+{
+  int numDrained = 0;
+  histogram->histogram.drainFinishedColumns(
+      histogram->elapsedMs(), [&](int64_t column, const LiveHistogram::ColumnCounts &counts) {
+        fn(user_data, column, counts.data(), int(counts.size()));
+        numDrained++;
+      });
+  return numDrained;
+}
+
+void mwf_get_stats(const mwf_histogram *histogram, mwf_stats *stats)
+{
+  const AllocationStats totals = histogram->histogram.stats();
+  stats->total_allocations = totals.totalAllocations;
+  stats->total_size = totals.totalSize;
+  stats->max_size = totals.maxSize;
+  stats->dropped_events = histogram->histogram.droppedEvents();
+}
+
+int mwf_num_size_buckets(void)
+{
+  return int(SIZE_BUCKETS.size());
+}
+
+uint64_t mwf_size_bucket_limit(int index)
+{
+  if (index < 0 || index >= int(SIZE_BUCKETS.size())) {
+    return 0;
+  }
+  return index + 1 < int(SIZE_BUCKETS.size()) ? uint64_t(SIZE_BUCKETS[index]) : UINT64_MAX;
+}
+
+int mwf_start_recording(mwf_histogram *histogram, const char *path)
+{
+  std::lock_guard lock(histogram->recordersMutex);
+  if (histogram->recorder.load()) {
+    return 0;
+  }
+
+  const std::u8string utf8Path(reinterpret_cast<const char8_t *>(path));
+  auto recorder = std::make_unique<TraceRecorder>(std::filesystem::path(utf8Path));
+  if (!recorder->open()) {
+    return 0;
+  }
+
+  histogram->recorder.store(recorder.get(), std::memory_order_release);
+  histogram->recorders.push_back(std::move(recorder));
+  return 1;
+}
+
+int mwf_stop_recording(mwf_histogram *histogram)
+{
+  std::lock_guard lock(histogram->recordersMutex);
+  if (TraceRecorder *current = histogram->recorder.exchange(nullptr)) {
+    current->close();
+    return current->failed() ? 0 : 1;
+  }
+  return 1;
+}
@@ -0,0 +1,133 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+/* In-process embedding API for the core library. A host application links
+ * MemoryWaterfallCore, creates a histogram and calls mwf_record() from its
+ * allocator. Recording is a clock read and a few relaxed atomic increments on
+ * one of several shards; events are never stored unless the host also writes a
+ * trace, which is not safe from inside an allocator (see mwf_start_recording()).
+ * The host drains finished columns from one thread whenever it likes, e.g. to
+ * publish or log them.
+ *
+ * Times are milliseconds since the histogram was created, on a monotonic
+ * clock, unless the host supplies its own with mwf_record_at(). */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mwf_histogram mwf_histogram;
+
+typedef struct mwf_stats {
+  uint64_t total_allocations;
+  uint64_t total_size;
+  uint64_t max_size;
+  /* Events that arrived for columns already drained or too far ahead */
+  uint64_t dropped_events;
+} mwf_stats;
+
+/* Receives the count of each size bucket for one finished column. */
+typedef void (*mwf_column_fn)(void *user_data,
+                              int64_t column,
+                              const uint32_t *counts,
+                              int num_size_buckets);
+
+/* Columns are `column_ms` wide and `num_columns` of them are kept between
+ * drains. Columns are finished once they ended `late_ms` ago; a negative value
+ * allows one column. Returns NULL if the arguments are invalid. */
+mwf_histogram *mwf_create(double column_ms, int num_columns, double late_ms);
+/* Stops any recording. No other calls may be in progress. */
+void mwf_destroy(mwf_histogram *histogram);
+
+/* Safe to call from any number of threads. Lock and allocation free unless a
+ * trace is being written, see mwf_start_recording(). The one exception is a
+ * core library loaded with dlopen(), where the C library may allocate the
+ * thread-local storage of a thread on its first call. */
+void mwf_record(mwf_histogram *histogram, size_t size);
+void mwf_record_at(mwf_histogram *histogram, double time_ms, size_t size);
+double mwf_elapsed_ms(const mwf_histogram *histogram);
+
+/* Calls fn for each column finished by now, oldest first, and returns how many
+ * there were. Only one thread may drain. */
+int mwf_drain(mwf_histogram *histogram, mwf_column_fn fn, void *user_data);
+void mwf_get_stats(const mwf_histogram *histogram, mwf_stats *stats);
+
+/* Size buckets are numbered from 0; each holds sizes up to and including its
+ * limit. The last one has no limit and reports UINT64_MAX. */
+int mwf_num_size_buckets(void);
+uint64_t mwf_size_bucket_limit(int index);
+
+/* Also writes every recorded event to a CSV trace (UTF-8 path) that the viewer
+ * can open. Each event is appended to a buffer under a lock shared with few
+ * other threads, and the buffer grows with malloc. While a trace is being
+ * written, mwf_record() and mwf_record_at() must therefore not be called from
+ * an allocator hook, or any other place that cannot take a lock or allocate.
+ * Record from a point outside the allocator instead, or do without the trace.
+ * Returns 0 if already recording or the file could not be opened. */
+int mwf_start_recording(mwf_histogram *histogram, const char *path);
+/* Writes the remaining events and closes the trace. Returns 0 if writing the
+ * trace failed, leaving it incomplete. */
+int mwf_stop_recording(mwf_histogram *histogram);
+
+#ifdef __cplusplus
+}
+
+#include <type_traits>
+
+/* Owning wrapper for C++ hosts. */
+class EmbeddedHistogram {
+ public:
+  EmbeddedHistogram(double columnMs, int numColumns, double lateMs = -1.0)
+      : histogram_(mwf_create(columnMs, numColumns, lateMs))
+  {
+  }
+  ~EmbeddedHistogram()
+  {
+    mwf_destroy(histogram_);
+  }
+  EmbeddedHistogram(const EmbeddedHistogram &) = delete;
+  EmbeddedHistogram &operator=(const EmbeddedHistogram &) = delete;
+
+  bool isValid() const
+  {
+    return histogram_ != nullptr;
+  }
+
+  void record(size_t size)
+  {
+    mwf_record(histogram_, size);
+  }
+
+  // Calls fn(column, counts, numSizeBuckets) for each finished column.
+  template<typename Fn> int drain(Fn &&fn)
+  {
+    return mwf_drain(
+        histogram_,
+        [](void *userData, int64_t column, const uint32_t *counts, int numSizeBuckets) {
+          auto &callback = *static_cast<std::remove_reference_t<Fn> *>(userData);
+          callback(column, counts, numSizeBuckets);
+        },
+        &fn);
+  }
+
+  mwf_stats stats() const
+  {
+    mwf_stats stats;
+    mwf_get_stats(histogram_, &stats);
+    return stats;
+  }
+
+  mwf_histogram *get() const
+  {
+    return histogram_;
+  }
+
+ private:
+  mwf_histogram *histogram_;
+};
+#endif
@@ -0,0 +1,162 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "Histogram.h"
+
+#include <thread>
+
+unsigned EventSliceCount(size_t numEvents, unsigned numThreads)
+{
+  // Small inputs are not worth the cost of spinning up threads and partials.
+  constexpr size_t MinEventsPerThread = 1 << 20;
+  return std::max(1u, std::min(numThreads, unsigned(numEvents / MinEventsPerThread)));
+}
+
+void ForEachEventSlice(size_t numEvents,
+                       unsigned numSlices,
+                       const std::function<void(unsigned, size_t, size_t)> &fn)
+{
+  std::vector<std::thread> workers;
+  workers.reserve(numSlices);
+
+  const size_t sliceSize = (numEvents + numSlices - 1) / numSlices;
+  for (unsigned i = 1; i < numSlices; ++i) {
+    const size_t first = std::min(numEvents, i * sliceSize);
+    workers.emplace_back(fn, i, first, std::min(numEvents, first + sliceSize));
+  }
+  fn(0, 0, std::min(numEvents, sliceSize));
+
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void BinEventsParallel(const AllocationEvents &events,
+                       const TimeGrid &grid,
+                       SparseAllocationData &data,
+                       unsigned numThreads)
+{
+  data.prepare(grid.numBuckets, int(SIZE_BUCKETS.size()));
+
+  const unsigned numSlices = EventSliceCount(events.size(), numThreads);
+  if (numSlices == 1) {
+    BinEvents(events.data(), events.data() + events.size(), grid, data);
+    return;
+  }
+
+  std::vector<SparseCountData> partials(numSlices);
+  ForEachEventSlice(events.size(), numSlices, [&](unsigned slice, size_t first, size_t last) {
+    partials[slice].prepare(grid.numBuckets, int(SIZE_BUCKETS.size()));
+    BinEvents(events.data() + first, events.data() + last, grid, partials[slice]);
+  });
+
+  for (const SparseCountData &partial : partials) {
+    data.add(partial);
+  }
+}
+
+BucketTotals AccumulateBucketTotals(const AllocationEvents &events, double startMs, double endMs)
+{
+  BucketTotals totals;
+  totals.counts.resize(SIZE_BUCKETS.size(), 0);
+  totals.sizes.resize(SIZE_BUCKETS.size(), 0);
+
+  for (const AllocationEvent &event : events) {
+    if (event.timeMs < startMs || event.timeMs > endMs) {
+      continue;
+    }
+
+    const int sizeBucket = GetSizeBucketIndex(event.size);
+    totals.counts[sizeBucket]++;
+    totals.sizes[sizeBucket] += event.size;
+  }
+
+  return totals;
+}
+
+AllocationStats ComputeStats(const AllocationEvents &events, double &startMs, double &timeRangeMs)
+{
+  AllocationStats stats;
+  startMs = 0.0;
+  timeRangeMs = 0.0;
+  if (events.empty()) {
+    return stats;
+  }
+
+  double minTime = events[0].timeMs;
+  double maxTime = events[0].timeMs;
+  for (const AllocationEvent &event : events) {
+    minTime = std::min(minTime, event.timeMs);
+    maxTime = std::max(maxTime, event.timeMs);
+    AccumulateStats(stats, event);
+  }
+
+  startMs = minTime;
+  timeRangeMs = maxTime - minTime;
+  return stats;
+}
+
+TraceComparison CompareTraces(AllocationEvents baseline,
+                              AllocationEvents candidate,
+                              double maxTimeRangeMs,
+                              int numColumns,
+                              unsigned numThreads)
+{
+  TraceComparison comparison;
+  comparison.baseline = std::move(baseline);
+  comparison.candidate = std::move(candidate);
+
+  double baselineRangeMs = 0.0;
+  double candidateRangeMs = 0.0;
+  std::thread baselineWorker([&]() {
+    comparison.baselineStats = ComputeStats(
+        comparison.baseline, comparison.baselineStartMs, baselineRangeMs);
+  });
+  comparison.candidateStats = ComputeStats(
+      comparison.candidate, comparison.candidateStartMs, candidateRangeMs);
+  baselineWorker.join();
+
+  comparison.timeRangeMs = std::min(std::max(baselineRangeMs, candidateRangeMs), maxTimeRangeMs);
+  comparison.timeRangeMs = std::max(comparison.timeRangeMs, 1.0);
+
+  baselineWorker = std::thread([&]() {
+    comparison.baselineTotals = AccumulateBucketTotals(
+        comparison.baseline,
+        comparison.baselineStartMs,
+        comparison.baselineStartMs + comparison.timeRangeMs);
+  });
+  comparison.candidateTotals = AccumulateBucketTotals(
+      comparison.candidate,
+      comparison.candidateStartMs,
+      comparison.candidateStartMs + comparison.timeRangeMs);
+  baselineWorker.join();
+
+  BinTraceComparison(comparison, numColumns, numThreads);
+  return comparison;
+}
+
+void BinTraceComparison(TraceComparison &comparison, int numColumns, unsigned numThreads)
+{
+  // Both traces share the bucket width so that column t covers the same
+  // offset from the start of each trace.
+  const double timeBucketMs = comparison.timeRangeMs / numColumns;
+  const TimeGrid baselineGrid{comparison.baselineStartMs, timeBucketMs, numColumns};
+  const TimeGrid candidateGrid{comparison.candidateStartMs, timeBucketMs, numColumns};
+  numThreads = std::max(2u, numThreads);
+
+  SparseAllocationData baselineData;
+  std::thread baselineWorker([&]() {
+    BinEventsParallel(comparison.baseline, baselineGrid, baselineData, numThreads / 2);
+  });
+  BinEventsParallel(
+      comparison.candidate, candidateGrid, comparison.difference, numThreads - numThreads / 2);
+  baselineWorker.join();
+
+  comparison.baselineStats.timeBucketMs = timeBucketMs;
+  comparison.baselineStats.maxTimeBucketAllocationCount = size_t(baselineData.maxCount());
+  comparison.candidateStats.timeBucketMs = timeBucketMs;
+  comparison.candidateStats.maxTimeBucketAllocationCount = size_t(
+      comparison.difference.maxCount());
+
+  comparison.difference.subtract(baselineData);
+}
@@ -0,0 +1,391 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+#include "SizeBuckets.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Counters narrower than 32 bits saturate instead of wrapping, so an overfull
+// cell still renders at the end of the colormap. Wider counters never get close.
+template<typename Counter> inline void IncrementCounter(Counter &counter)
+{
+  if constexpr (sizeof(Counter) < sizeof(uint32_t)) {
+    if (counter != std::numeric_limits<Counter>::max()) {
+      ++counter;
+    }
+  }
+  else {
+    ++counter;
+  }
+}
+
+template<typename Counter> inline Counter SaturatingAdd(Counter counter, int64_t delta)
+{
+  const int64_t sum = int64_t(counter) + delta;
+  return Counter(std::clamp<int64_t>(sum,
+                                     int64_t(std::numeric_limits<Counter>::min()),
+                                     int64_t(std::numeric_limits<Counter>::max())));
+}
+
+// Time-major dense storage: the size buckets of one time bucket are
+// contiguous. Events are binned, drawn and resampled in time order, so every
+// pass walks memory sequentially.
+template<typename Counter> class DenseColumns {
+ public:
+  void prepare(int numTimeBuckets, int numSizeBuckets)
+  {
+    numSizeBuckets_ = numSizeBuckets;
+    counts_.assign(size_t(numTimeBuckets) * numSizeBuckets, Counter(0));
+  }
+
+  Counter get(int timeBucket, int sizeBucket) const
+  {
+    return counts_[size_t(timeBucket) * numSizeBuckets_ + sizeBucket];
+  }
+
+  template<typename Op> void update(int timeBucket, int sizeBucket, Op &&op)
+  {
+    op(counts_[size_t(timeBucket) * numSizeBuckets_ + sizeBucket]);
+  }
+
+  template<typename Fn> void processColumn(int timeBucket, Fn &&fn) const
+  {
+    const Counter *column = &counts_[size_t(timeBucket) * numSizeBuckets_];
+    for (int s = 0; s < numSizeBuckets_; ++s) {
+      if (column[s] != 0) {
+        fn(s, column[s]);
+      }
+    }
+  }
+
+ private:
+  int numSizeBuckets_ = 0;
+  std::vector<Counter> counts_;
+};
+
+// Sparse storage for histograms where most cells are empty, such as fine time
+// resolutions or the rarely used large size buckets. Each time bucket keeps a
+// bitmask of its occupied size buckets and only their counts, in bucket order.
+template<typename Counter> class SparseColumns {
+ public:
+  static constexpr int MaxSizeBuckets = 64;
+
+  void prepare(int numTimeBuckets, int numSizeBuckets)
+  {
+    assert(numSizeBuckets <= MaxSizeBuckets);
+    // Columns keep their storage, so re-binning onto the same grid, as live
+    // updates do, does not allocate again
+    columns_.resize(size_t(numTimeBuckets));
+    for (Column &column : columns_) {
+      column.mask = 0;
+      column.counts.clear();
+    }
+  }
+
+  Counter get(int timeBucket, int sizeBucket) const
+  {
+    const Column &column = columns_[timeBucket];
+    const uint64_t bit = uint64_t(1) << sizeBucket;
+    if ((column.mask & bit) == 0) {
+      return Counter(0);
+    }
+    return column.counts[std::popcount(column.mask & (bit - 1))];
+  }
+
+  template<typename Op> void update(int timeBucket, int sizeBucket, Op &&op)
+  {
+    Column &column = columns_[timeBucket];
+    const uint64_t bit = uint64_t(1) << sizeBucket;
+    const int index = std::popcount(column.mask & (bit - 1));
+    if ((column.mask & bit) == 0) {
+      column.mask |= bit;
+      column.counts.insert(column.counts.begin() + index, Counter(0));
+    }
+    op(column.counts[index]);
+  }
+
+  template<typename Fn> void processColumn(int timeBucket, Fn &&fn) const
+  {
+    const Column &column = columns_[timeBucket];
+    int index = 0;
+    for (uint64_t mask = column.mask; mask != 0; mask &= mask - 1) {
+      const Counter count = column.counts[index++];
+      if (count != 0) {
+        fn(std::countr_zero(mask), count);
+      }
+    }
+  }
+
+ private:
+  struct Column {
+    uint64_t mask = 0;
+    std::vector<Counter> counts;
+  };
+
+  std::vector<Column> columns_;
+};
+
+static_assert(SizeBucketScheme::MaxSize <= SparseColumns<int>::MaxSizeBuckets);
+
+// Time x size histogram of allocation counts. `Counter` selects the cell width
+// (int16_t saturating, uint32_t, or int32_t when differences are stored) and
+// `Layout` the storage, dense or sparse.
+template<typename Counter, template<typename> class Layout = DenseColumns>
+class BasicAllocationData {
+ public:
+  using CounterType = Counter;
+
+  void prepare(int numTimeBuckets, int numSizeBuckets)
+  {
+    numTimeBuckets_ = numTimeBuckets;
+    numSizeBuckets_ = numSizeBuckets;
+    storage_.prepare(numTimeBuckets, numSizeBuckets);
+  }
+
+  int numTimeBuckets() const
+  {
+    return numTimeBuckets_;
+  }
+
+  int numSizeBuckets() const
+  {
+    return numSizeBuckets_;
+  }
+
+  void incrementCount(int timeBucket, int sizeBucket)
+  {
+    storage_.update(timeBucket, sizeBucket, [](Counter &count) { IncrementCounter(count); });
+  }
+
+  void addCount(int timeBucket, int sizeBucket, int64_t delta)
+  {
+    storage_.update(timeBucket, sizeBucket, [delta](Counter &count) {
+      count = SaturatingAdd(count, delta);
+    });
+  }
+
+  Counter count(int timeBucket, int sizeBucket) const
+  {
+    return storage_.get(timeBucket, sizeBucket);
+  }
+
+  template<typename Other> void add(const Other &other)
+  {
+    other.process([&](int t, int s, auto count) { addCount(t, s, int64_t(count)); });
+  }
+
+  template<typename Other> void subtract(const Other &other)
+  {
+    other.process([&](int t, int s, auto count) { addCount(t, s, -int64_t(count)); });
+  }
+
+  // Calls fn(sizeBucket, count) for every non-zero cell of one time bucket.
+  template<typename Fn> void processColumn(int timeBucket, Fn &&fn) const
+  {
+    storage_.processColumn(timeBucket, fn);
+  }
+
+  // Calls fn(timeBucket, sizeBucket, count) for every non-zero cell.
+  template<typename Fn> void process(Fn &&fn) const
+  {
+    for (int t = 0; t < numTimeBuckets_; ++t) {
+      storage_.processColumn(t, [&](int s, Counter count) { fn(t, s, count); });
+    }
+  }
+
+  Counter maxCount() const
+  {
+    Counter maxCount = 0;
+    process([&](int, int, Counter count) { maxCount = std::max(maxCount, count); });
+    return maxCount;
+  }
+
+ private:
+  int numTimeBuckets_ = 0;
+  int numSizeBuckets_ = 0;
+  Layout<Counter> storage_;
+};
+
+// For histograms at full time resolution, whose cells are mostly empty. Signed
+// so that the same type can also hold the difference of two histograms.
+using SparseAllocationData = BasicAllocationData<int32_t, SparseColumns>;
+// Partials only ever count up, so they use unsigned counters.
+using SparseCountData = BasicAllocationData<uint32_t, SparseColumns>;
+// Half the size for histograms that are only drawn. Counts and differences
+// saturate far beyond the ends of the colormaps.
+using CompactAllocationData = BasicAllocationData<int16_t>;
+
+// Describes how event timestamps map onto time buckets. Two traces binned with
+// grids of the same bucketMs and numBuckets produce directly comparable data.
+struct TimeGrid {
+  double startMs = 0.0;
+  double bucketMs = 0.0;
+  int numBuckets = 0;
+
+  double endMs() const
+  {
+    return startMs + bucketMs * numBuckets;
+  }
+};
+
+// Per size bucket totals over a time range, independent of the time bucket resolution.
+struct BucketTotals {
+  std::vector<size_t> counts;
+  std::vector<size_t> sizes;
+};
+
+template<typename Data, typename Filter>
+void BinEventsIf(const AllocationEvent *begin,
+                 const AllocationEvent *end,
+                 const TimeGrid &grid,
+                 const SizeBucketScheme &sizes,
+                 Data &data,
+                 Filter &&filter)
+{
+  const double endMs = grid.endMs();
+
+  for (const AllocationEvent *event = begin; event != end; ++event) {
+    if (event->timeMs < grid.startMs || event->timeMs > endMs || !filter(event - begin)) {
+      continue;
+    }
+
+    int timeBucket = int((event->timeMs - grid.startMs) / grid.bucketMs);
+    if (timeBucket >= grid.numBuckets) {
+      timeBucket = grid.numBuckets - 1;
+    }
+    const int sizeBucket = sizes.indexOf(event->size);
+
+    data.incrementCount(timeBucket, sizeBucket);
+  }
+}
+
+// `data` must have been prepared with `sizes.size()` size buckets.
+template<typename Data>
+void BinEvents(const AllocationEvent *begin,
+               const AllocationEvent *end,
+               const TimeGrid &grid,
+               Data &data,
+               const SizeBucketScheme &sizes = SizeBucketScheme::Default())
+{
+  BinEventsIf(begin, end, grid, sizes, data, [](ptrdiff_t) { return true; });
+}
+
+// Same as above, but only bins events whose entry in the parallel `sources`
+// array equals `source`.
+template<typename Data>
+void BinEvents(const AllocationEvent *begin,
+               const AllocationEvent *end,
+               const uint16_t *sources,
+               uint16_t source,
+               const TimeGrid &grid,
+               Data &data,
+               const SizeBucketScheme &sizes = SizeBucketScheme::Default())
+{
+  BinEventsIf(begin, end, grid, sizes, data, [&](ptrdiff_t i) { return sources[i] == source; });
+}
+
+// Number of slices to split `numEvents` events into for up to `numThreads`
+// workers, each of which accumulates into its own partial result.
+unsigned EventSliceCount(size_t numEvents, unsigned numThreads);
+
+// Calls fn(slice, first, last) for `numSlices` contiguous ranges of event
+// indices, each on its own thread except the first, which runs on the calling
+// thread, and returns once all of them are done.
+void ForEachEventSlice(size_t numEvents,
+                       unsigned numSlices,
+                       const std::function<void(unsigned, size_t, size_t)> &fn);
+
+// Splits the events across `numThreads` workers, each binning into its own
+// partial histogram, then sums the partials into `data`. Both are sparse, so
+// fine time resolutions cost memory only for the cells that hold events.
+void BinEventsParallel(const AllocationEvents &events,
+                       const TimeGrid &grid,
+                       SparseAllocationData &data,
+                       unsigned numThreads);
+
+// Resamples `source` to `numTimeBuckets` columns. When shrinking, each output
+// column keeps the count of largest magnitude among the columns it covers so
+// short bursts stay visible at any width. When growing, columns are repeated.
+// Either way the counts keep the meaning of the source time bucket size.
+template<typename Source, typename Dest>
+void ResampleTimeBuckets(const Source &source, int numTimeBuckets, Dest &dest)
+{
+  const int numSizeBuckets = source.numSizeBuckets();
+  dest.prepare(numTimeBuckets, numSizeBuckets);
+  if (source.numTimeBuckets() == 0) {
+    return;
+  }
+
+  std::vector<int64_t> column(numSizeBuckets);
+  for (int x = 0; x < numTimeBuckets; ++x) {
+    const int first = int(int64_t(x) * source.numTimeBuckets() / numTimeBuckets);
+    const int last = std::max(first + 1,
+                              int(int64_t(x + 1) * source.numTimeBuckets() / numTimeBuckets));
+
+    std::fill(column.begin(), column.end(), 0);
+    for (int t = first; t < last; ++t) {
+      source.processColumn(t, [&](int s, auto count) {
+        if (std::abs(int64_t(count)) > std::abs(column[s])) {
+          column[s] = int64_t(count);
+        }
+      });
+    }
+
+    for (int s = 0; s < numSizeBuckets; ++s) {
+      if (column[s] != 0) {
+        dest.addCount(x, s, column[s]);
+      }
+    }
+  }
+}
+
+BucketTotals AccumulateBucketTotals(const AllocationEvents &events, double startMs, double endMs);
+
+// Adds one event to the allocation totals. The time bucket fields are left to the caller.
+inline void AccumulateStats(AllocationStats &stats, const AllocationEvent &event)
+{
+  stats.totalAllocations++;
+  stats.totalSize += event.size;
+  stats.maxSize = std::max(stats.maxSize, event.size);
+}
+
+// Allocation totals over all of `events`, along with the time range they span.
+AllocationStats ComputeStats(const AllocationEvents &events, double &startMs, double &timeRangeMs);
+
+// A baseline and a candidate trace prepared for comparison. Each trace is
+// aligned to its own first event and both share the time range.
+struct TraceComparison {
+  AllocationEvents baseline;
+  AllocationEvents candidate;
+  AllocationStats baselineStats;
+  AllocationStats candidateStats;
+  BucketTotals baselineTotals;
+  BucketTotals candidateTotals;
+  double baselineStartMs = 0.0;
+  double candidateStartMs = 0.0;
+  double timeRangeMs = 0.0;
+  // Candidate minus baseline counts
+  SparseAllocationData difference;
+};
+
+// Computes the stats and totals of both traces over at most `maxTimeRangeMs`
+// and bins their difference into `numColumns` time buckets. Takes a while for
+// large traces, so viewers run it off their GUI thread.
+TraceComparison CompareTraces(AllocationEvents baseline,
+                              AllocationEvents candidate,
+                              double maxTimeRangeMs,
+                              int numColumns,
+                              unsigned numThreads);
+
+// Bins the difference of `comparison` again, into `numColumns` time buckets.
+void BinTraceComparison(TraceComparison &comparison, int numColumns, unsigned numThreads);
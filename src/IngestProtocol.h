@@ -0,0 +1,43 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include <cstdint>
+#include <time.h>
+
+// Binary protocol for streaming allocation events to the viewer over a local
+// Unix domain socket. A client sends any number of batches back to back, each
+// an IngestBatchHeader followed by `count` IngestEvents. Producers and viewer
+// share the host, so fields are in native byte order and times are on the
+// CLOCK_MONOTONIC timeline.
+
+constexpr uint32_t INGEST_BATCH_MAGIC = 0x3242574d;  // "MWB2"
+constexpr uint32_t INGEST_MAX_BATCH_EVENTS = 64 * 1024;
+constexpr const char *INGEST_DEFAULT_SOCKET_PATH = "/tmp/memory-waterfall.sock";
+
+struct IngestBatchHeader {
+  uint32_t magic;
+  uint32_t count;
+  // When the batch was handed to the socket, for measuring latency
+  uint64_t sendTimeNs;
+  // Event times are offsets from this time
+  uint64_t baseTimeNs;
+};
+
+struct IngestEvent {
+  uint32_t timeOffsetNs;
+  // Reserved, set to zero
+  uint32_t reserved;
+  uint64_t size;
+};
+
+static_assert(sizeof(IngestBatchHeader) == 24);
+static_assert(sizeof(IngestEvent) == 16);
+
+inline uint64_t IngestClockNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return uint64_t(now.tv_sec) * 1000000000ull + uint64_t(now.tv_nsec);
+}
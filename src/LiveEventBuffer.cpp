@@ -0,0 +1,40 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "LiveEventBuffer.h"
+
+#include <algorithm>
+
+void LiveEventBuffer::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.clear();
+}
+
+void LiveEventBuffer::append(const AllocationEvents &events)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.insert(events_.end(), events.begin(), events.end());
+}
+
+void LiveEventBuffer::getRecentEvents(double cutoffTimeMs, AllocationEvents &recent)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  recent.clear();
+
+  // Trigger cleanup once there's a meaningful buildup of old events
+  const size_t cutoffSize = 512 * 1024;
+
+  size_t firstRecent = events_.size();
+  for (size_t i = 0; i < events_.size(); ++i) {
+    if (events_[i].timeMs >= cutoffTimeMs) {
+      firstRecent = std::min(firstRecent, i);
+      recent.push_back(events_[i]);
+    }
+  }
+
+  if (firstRecent > cutoffSize) {
+    events_.erase(events_.begin(), events_.begin() + firstRecent);
+  }
+}
@@ -0,0 +1,24 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+
+#include <mutex>
+
+// Raw events of a live source that does not aggregate at ingest. Events may be
+// appended from any thread and in any time order.
+class LiveEventBuffer {
+ public:
+  void clear();
+  void append(const AllocationEvents &events);
+
+  // Copies the events at or after `cutoffTimeMs` into `recent` and drops old
+  // events once enough of them have built up.
+  void getRecentEvents(double cutoffTimeMs, AllocationEvents &recent);
+
+ private:
+  std::mutex mutex_;
+  AllocationEvents events_;
+};
@@ -0,0 +1,106 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "LiveHistogram.h"
+
+#include <algorithm>
+#include <thread>
+
+LiveHistogram::LiveHistogram(double columnMs, int numColumns, double lateMs, int numShards)
+    : columnMs_(columnMs),
+      lateMs_(lateMs < 0.0 ? columnMs : lateMs),
+      numColumns_(std::max(2, numColumns)),
+      numShards_(std::max(1, numShards)),
+      shards_(std::make_unique<Shard[]>(size_t(numShards_)))
+{
+  const size_t numCells = size_t(numColumns_) * NumSizeBuckets;
+  for (int i = 0; i < numShards_; ++i) {
+    shards_[i].counts = std::make_unique<std::atomic<uint32_t>[]>(numCells);
+    for (size_t cell = 0; cell < numCells; ++cell) {
+      shards_[i].counts[cell].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void LiveHistogram::record(double timeMs, size_t size)
+{
+  Shard &shard = shards_[ThreadShardIndex() % unsigned(numShards_)];
+
+  const int64_t column = int64_t(std::max(timeMs, 0.0) / columnMs_);
+
+  // Announced before the check so that retireColumns() waits for the count.
+  // The slot of the column being drained is one ring ahead, hence the - 1.
+  std::atomic<uint32_t> &recording = shard.recording[phase_.load(std::memory_order_seq_cst)];
+  recording.fetch_add(1, std::memory_order_seq_cst);
+  const int64_t nextColumn = nextColumn_.load(std::memory_order_seq_cst);
+  if (column < nextColumn || column >= nextColumn + numColumns_ - 1) {
+    recording.fetch_sub(1, std::memory_order_release);
+    shard.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const size_t cell = size_t(column % numColumns_) * NumSizeBuckets + GetSizeBucketIndex(size);
+  shard.counts[cell].fetch_add(1, std::memory_order_relaxed);
+  recording.fetch_sub(1, std::memory_order_release);
+
+  shard.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+  shard.totalSize.fetch_add(size, std::memory_order_relaxed);
+  uint64_t maxSize = shard.maxSize.load(std::memory_order_relaxed);
+  while (size > maxSize &&
+         !shard.maxSize.compare_exchange_weak(maxSize, size, std::memory_order_relaxed))
+  {
+  }
+}
+
+void LiveHistogram::retireColumns(int64_t nextColumn)
+{
+  nextColumn_.store(nextColumn, std::memory_order_seq_cst);
+
+  // Threads that record from here on use the other phase and see the new
+  // nextColumn_, so only those that started before have to finish. Together
+  // with record() this is a store-then-load handshake on both sides, so every
+  // access in it has to be seq_cst.
+  const uint32_t phase = phase_.load(std::memory_order_relaxed);
+  phase_.store(phase ^ 1, std::memory_order_seq_cst);
+  for (int i = 0; i < numShards_; ++i) {
+    while (shards_[i].recording[phase].load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void LiveHistogram::drainColumn(int64_t column, ColumnCounts &counts)
+{
+  counts.fill(0);
+
+  const size_t firstCell = size_t(column % numColumns_) * NumSizeBuckets;
+  for (int i = 0; i < numShards_; ++i) {
+    std::atomic<uint32_t> *cells = &shards_[i].counts[firstCell];
+    for (int s = 0; s < NumSizeBuckets; ++s) {
+      counts[s] += cells[s].exchange(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+AllocationStats LiveHistogram::stats() const
+{
+  AllocationStats stats;
+  stats.timeBucketMs = columnMs_;
+  for (int i = 0; i < numShards_; ++i) {
+    const Shard &shard = shards_[i];
+    stats.totalAllocations += shard.totalAllocations.load(std::memory_order_relaxed);
+    stats.totalSize += shard.totalSize.load(std::memory_order_relaxed);
+    stats.maxSize = std::max(stats.maxSize,
+                             size_t(shard.maxSize.load(std::memory_order_relaxed)));
+  }
+  return stats;
+}
+
+size_t LiveHistogram::droppedEvents() const
+{
+  size_t dropped = 0;
+  for (int i = 0; i < numShards_; ++i) {
+    dropped += shards_[i].dropped.load(std::memory_order_relaxed);
+  }
+  return dropped;
+}
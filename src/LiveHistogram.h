@@ -0,0 +1,111 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+#include "SizeBuckets.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Time x size histogram that data sources update directly at ingest, so raw
+// events never need to be stored. Columns of `columnMs` live in a ring of
+// `numColumns`. Each recording thread is assigned one of several shards of
+// relaxed atomic counters to avoid contending on the same cache lines.
+//
+// A single reader drains columns once they are finished, i.e. they ended at
+// least `lateMs` before the current time. Sources that deliver events with some
+// delay, such as ETW, need a larger allowance. Events for columns that were
+// already drained, or too far ahead of the reader, are dropped and counted.
+// A column is only drained once every event that was accepted for it has been
+// added, so a late event is either drained with its column or dropped.
+class LiveHistogram {
+ public:
+  static constexpr int NumSizeBuckets = int(SIZE_BUCKETS.size());
+  static constexpr int DefaultNumShards = 8;
+
+  using ColumnCounts = std::array<uint32_t, NumSizeBuckets>;
+
+  // A negative `lateMs` allows one column.
+  LiveHistogram(double columnMs,
+                int numColumns,
+                double lateMs = -1.0,
+                int numShards = DefaultNumShards);
+
+  // Safe to call from any number of threads.
+  void record(double timeMs, size_t size);
+
+  // Calls fn(column, counts) for each finished column not yet drained, oldest
+  // first, and clears them for reuse. Only one thread may drain.
+  template<typename Fn> void drainFinishedColumns(double nowMs, Fn &&fn)
+  {
+    const int64_t firstColumn = nextColumn_.load(std::memory_order_relaxed);
+    const int64_t finishedEnd = finishedColumnEnd(nowMs);
+    if (finishedEnd <= firstColumn) {
+      return;
+    }
+
+    // Nothing was recorded more than one ring length past the last drain
+    const int64_t drainEnd = std::min(finishedEnd, firstColumn + numColumns_);
+
+    ColumnCounts counts;
+    for (int64_t column = firstColumn; column < drainEnd; ++column) {
+      retireColumns(column + 1);
+      drainColumn(column, counts);
+      fn(column, counts);
+    }
+
+    if (finishedEnd > drainEnd) {
+      retireColumns(finishedEnd);
+    }
+  }
+
+  // One past the newest column that is finished at `nowMs`.
+  int64_t finishedColumnEnd(double nowMs) const
+  {
+    return std::max<int64_t>(int64_t((nowMs - lateMs_) / columnMs_), 0);
+  }
+
+  double columnMs() const
+  {
+    return columnMs_;
+  }
+
+  int numColumns() const
+  {
+    return numColumns_;
+  }
+
+  // Totals over everything recorded so far; timeBucketMs is the column size.
+  AllocationStats stats() const;
+  size_t droppedEvents() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+    std::atomic<uint64_t> totalAllocations = 0;
+    std::atomic<uint64_t> totalSize = 0;
+    std::atomic<uint64_t> maxSize = 0;
+    std::atomic<uint64_t> dropped = 0;
+    // Recording threads between checking and counting an event, by the phase
+    // they started in
+    std::atomic<uint32_t> recording[2] = {0, 0};
+  };
+
+  // Stops accepting events for columns before `nextColumn` and waits for
+  // events already accepted for them to be counted.
+  void retireColumns(int64_t nextColumn);
+  void drainColumn(int64_t column, ColumnCounts &counts);
+
+  double columnMs_;
+  double lateMs_;
+  int numColumns_;
+  int numShards_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<int64_t> nextColumn_ = 0;
+  std::atomic<uint32_t> phase_ = 0;
+};
@@ -2,19 +2,31 @@
  *
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #include "MainWindow.h"
-#include "CSVDataSource.h"
 #include "DataSource.h"
-#include "ETWDataSource.h"
+#include "SizeBuckets.h"
+#include "SizeClasses.h"
 
 #include <QAction>
+#include <QActionGroup>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QKeySequence>
+#include <QLineEdit>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QStatusBar>
 
+#include <limits>
+
+#ifdef __linux__
+#  include "IngestProtocol.h"
+#endif
+
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), etwDataSource_(nullptr), updateTimer_(nullptr), isLiveCapture_(false)
+    : QMainWindow(parent), updateTimer_(nullptr), isLiveCapture_(false)
 {
   setWindowTitle("Memory Waterfall Viewer");
 
@@ -25,79 +37,535 @@ MainWindow::MainWindow(QWidget *parent)
   QAction *openAction = fileMenu->addAction("&Open CSV...");
   connect(openAction, &QAction::triggered, this, &MainWindow::loadData);
 
+  QAction *openMergedAction = fileMenu->addAction("Open &Multiple CSV...");
+  connect(openMergedAction, &QAction::triggered, this, &MainWindow::loadMergedData);
+
+  QAction *compareAction = fileMenu->addAction("&Compare CSV...");
+  connect(compareAction, &QAction::triggered, this, &MainWindow::compareData);
+
+  QAction *exportBookmarksAction = fileMenu->addAction("&Export Bookmarks...");
+  connect(exportBookmarksAction, &QAction::triggered, this, &MainWindow::exportBookmarks);
+
+  cancelLoadAction_ = fileMenu->addAction("C&ancel Loading");
+  cancelLoadAction_->setShortcut(QKeySequence::Cancel);
+  cancelLoadAction_->setEnabled(false);
+  connect(cancelLoadAction_, &QAction::triggered, this, &MainWindow::cancelLoading);
+
   fileMenu->addSeparator();
 
   QAction *exitAction = fileMenu->addAction("E&xit");
   connect(exitAction, &QAction::triggered, this, &QMainWindow::close);
 
+  QMenu *viewMenu = menuBar()->addMenu("&View");
+  sourceMenu_ = viewMenu->addMenu("&Source");
+  sourceMenu_->setEnabled(false);
+
+  QAction *resolutionAction = viewMenu->addAction("Time &Resolution...");
+  connect(resolutionAction, &QAction::triggered, this, [this]() {
+    bool ok = false;
+    const int numColumns = QInputDialog::getInt(this,
+                                                "Time Resolution",
+                                                "Time buckets per window:",
+                                                waterfallWidget_->accumulationColumns(),
+                                                256,
+                                                65536,
+                                                256,
+                                                &ok);
+    if (ok) {
+      waterfallWidget_->setAccumulationColumns(numColumns);
+    }
+  });
+
+  viewMenu->addSeparator();
+
+  QAction *showBurstsAction = viewMenu->addAction("Show &Bursts");
+  showBurstsAction->setCheckable(true);
+  showBurstsAction->setChecked(true);
+  connect(showBurstsAction, &QAction::toggled, waterfallWidget_, &WaterfallWidget::setShowBursts);
+
+  QAction *burstThresholdAction = viewMenu->addAction("Burst &Threshold...");
+  connect(burstThresholdAction, &QAction::triggered, this, [this]() {
+    bool ok = false;
+    const double threshold = QInputDialog::getDouble(this,
+                                                     "Burst Threshold",
+                                                     "Standard deviations above the average:",
+                                                     waterfallWidget_->burstThreshold(),
+                                                     1.0,
+                                                     50.0,
+                                                     1,
+                                                     &ok);
+    if (ok) {
+      waterfallWidget_->setBurstThreshold(threshold);
+    }
+  });
+
+  viewMenu->addSeparator();
+
+  QAction *recommendAction = viewMenu->addAction("Recommend Size &Classes...");
+  connect(recommendAction, &QAction::triggered, this, &MainWindow::recommendSizeClasses);
+
+  QAction *loadSizeClassesAction = viewMenu->addAction("&Load Size Classes...");
+  connect(loadSizeClassesAction, &QAction::triggered, this, &MainWindow::loadSizeClasses);
+
+  QAction *defaultBucketsAction = viewMenu->addAction("&Default Size Buckets");
+  connect(defaultBucketsAction, &QAction::triggered, this, [this]() {
+    waterfallWidget_->setSizeBuckets(SizeBucketScheme::Default());
+  });
+
   QMenu *captureMenu = menuBar()->addMenu("&Capture");
+#ifdef _WIN32
   QAction *startCaptureAction = captureMenu->addAction("&Start Live Capture");
   connect(startCaptureAction, &QAction::triggered, this, &MainWindow::startLiveCapture);
+#endif
+
+  QAction *replayAction = captureMenu->addAction("&Replay CSV...");
+  connect(replayAction, &QAction::triggered, this, &MainWindow::startReplay);
+
+#ifdef __linux__
+  QAction *socketAction = captureMenu->addAction("&Listen on Socket...");
+  connect(socketAction, &QAction::triggered, this, &MainWindow::startSocketCapture);
+#endif
 
   QAction *stopCaptureAction = captureMenu->addAction("S&top Live Capture");
   connect(stopCaptureAction, &QAction::triggered, this, &MainWindow::stopLiveCapture);
 
+  // Records until the capture is stopped
+  recordAction_ = captureMenu->addAction("Record to &CSV...");
+  recordAction_->setEnabled(false);
+  connect(recordAction_, &QAction::triggered, this, &MainWindow::startRecording);
+
+  captureMenu->addSeparator();
+
+  // Takes effect from the next capture
+  aggregateAction_ = captureMenu->addAction("&Aggregate at Source");
+  aggregateAction_->setCheckable(true);
+
+  compareTable_ = new QTableWidget(int(SIZE_BUCKETS.size()), 6, this);
+  compareTable_->setHorizontalHeaderLabels(
+      {"Size Bucket", "Baseline", "Candidate", "Delta", "Delta %", "Delta Bytes"});
+  compareTable_->verticalHeader()->setVisible(false);
+  compareTable_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+  compareDock_ = new QDockWidget("Bucket Deltas", this);
+  compareDock_->setWidget(compareTable_);
+  compareDock_->hide();
+  addDockWidget(Qt::RightDockWidgetArea, compareDock_);
+
+  loadProgress_ = new QProgressBar(this);
+  loadProgress_->setRange(0, 1000);
+  loadProgress_->setMaximumWidth(200);
+  loadProgress_->hide();
+  statusBar()->addPermanentWidget(loadProgress_);
+
+  cancelLoadButton_ = new QPushButton("Cancel", this);
+  cancelLoadButton_->hide();
+  connect(cancelLoadButton_, &QPushButton::clicked, this, &MainWindow::cancelLoading);
+  statusBar()->addPermanentWidget(cancelLoadButton_);
+
+  loadTimer_ = new QTimer(this);
+  connect(loadTimer_, &QTimer::timeout, this, &MainWindow::updateFromLoader);
+  connect(this,
+          &MainWindow::sizeClassesReady,
+          this,
+          &MainWindow::updateFromSizeClassLoader,
+          Qt::QueuedConnection);
+
   statusBar()->showMessage("Ready");
 
+  updateTimer_ = new QTimer(this);
+  connect(updateTimer_, &QTimer::timeout, this, &MainWindow::updateFromLiveSource);
+
+#ifdef _WIN32
   etwDataSource_ = new ETWDataSource(this);
   connect(etwDataSource_, &ETWDataSource::errorOccurred, this, [this](const QString &error) {
     QMessageBox::critical(this, "ETW Error", error);
     statusBar()->showMessage("ETW capture failed");
   });
 
-  updateTimer_ = new QTimer(this);
-  connect(updateTimer_, &QTimer::timeout, this, &MainWindow::updateFromETW);
-
   startLiveCapture();
+#endif
 }
 
 MainWindow::~MainWindow()
 {
-  if (etwDataSource_ && etwDataSource_->isRunning()) {
-    etwDataSource_->stop();
+  if (loader_) {
+    loader_->cancel();
+  }
+  if (compareLoader_) {
+    compareLoader_->cancel();
+  }
+  if (sizeClassLoader_) {
+    sizeClassLoader_->cancel();
+  }
+
+  // The source must be stopped before the histogram it records into goes away
+  if (liveSource_) {
+    liveSource_->stop();
   }
 }
 
 void MainWindow::loadData()
 {
-  QString fileName = QFileDialog::getOpenFileName(
+  const QString fileName = QFileDialog::getOpenFileName(
       this, "Open CSV File", "", "CSV Files (*.csv);;All Files (*)");
 
   if (fileName.isEmpty()) {
     return;
   }
 
+  startLoading({fileName});
+}
+
+void MainWindow::loadMergedData()
+{
+  const QStringList fileNames = QFileDialog::getOpenFileNames(
+      this, "Open CSV Files", "", "CSV Files (*.csv);;All Files (*)");
+
+  if (fileNames.isEmpty()) {
+    return;
+  }
+
+  if (fileNames.size() > std::numeric_limits<uint16_t>::max()) {
+    QMessageBox::warning(this, "Error", "Too many files selected");
+    return;
+  }
+
+  startLoading(fileNames);
+}
+
+void MainWindow::startLoading(const QStringList &fileNames)
+{
+  // Live capture and any previous load must be fully shut down before the
+  // widget switches over to the new trace.
   if (isLiveCapture_) {
     stopLiveCapture();
   }
+  cancelLoading();
+
+  loadingFileNames_ = fileNames;
+  loader_ = std::make_unique<TraceLoader>(fileNames);
+
+  waterfallWidget_->beginProgressiveData();
+  compareDock_->hide();
+  updateSourceMenu(loader_->isMerged() ? fileNames : QStringList());
+
+  showLoadProgress("Loading...");
+  loader_->start();
+  loadTimer_->start(30);
+}
 
-  CSVDataSource dataSource(fileName);
-  auto events = dataSource.loadData();
+void MainWindow::showLoadProgress(const QString &message)
+{
+  loadProgress_->setValue(0);
+  loadProgress_->show();
+  cancelLoadButton_->show();
+  cancelLoadAction_->setEnabled(true);
+  statusBar()->showMessage(message);
+}
 
-  if (events.empty()) {
+void MainWindow::hideLoadProgress()
+{
+  loadTimer_->stop();
+  loadProgress_->hide();
+  cancelLoadButton_->hide();
+  cancelLoadAction_->setEnabled(false);
+}
+
+void MainWindow::cancelLoading()
+{
+  if (loader_) {
+    loader_->cancel();
+    updateFromLoader();
+  }
+  if (compareLoader_) {
+    compareLoader_->cancel();
+    updateFromCompareLoader();
+  }
+  if (sizeClassLoader_) {
+    sizeClassLoader_->cancel();
+    updateFromSizeClassLoader();
+  }
+}
+
+void MainWindow::updateFromLoader()
+{
+  if (compareLoader_) {
+    updateFromCompareLoader();
+    return;
+  }
+  if (sizeClassLoader_) {
+    updateFromSizeClassLoader();
+    return;
+  }
+  if (!loader_) {
+    return;
+  }
+
+  // Check for completion before taking the events so nothing parsed after the
+  // check can be left behind.
+  const bool finished = loader_->isFinished();
+
+  AllocationEvents events;
+  AllocationSources sources;
+  loader_->takeEvents(events, sources);
+  loadedEventCount_ += events.size();
+  waterfallWidget_->appendData(events, sources);
+
+  const int64_t totalBytes = std::max<int64_t>(loader_->totalBytes(), 1);
+  loadProgress_->setValue(int(1000 * loader_->bytesRead() / totalBytes));
+
+  if (!finished) {
+    return;
+  }
+
+  hideLoadProgress();
+  waterfallWidget_->endProgressiveData();
+
+  const bool canceled = loader_->wasCanceled();
+  loader_.reset();
+
+  if (loadedEventCount_ == 0 && !canceled) {
+    QMessageBox::warning(this, "Error", "Failed to load data from file");
+  }
+
+  const QString message = canceled ? "Loading canceled after %1 events from %2 CSV file(s)" :
+                                     "Loaded %1 events from %2 CSV file(s)";
+  statusBar()->showMessage(message.arg(loadedEventCount_).arg(loadingFileNames_.size()));
+  loadedEventCount_ = 0;
+}
+
+void MainWindow::updateSourceMenu(const QStringList &fileNames)
+{
+  sourceMenu_->clear();
+  sourceMenu_->setEnabled(!fileNames.isEmpty());
+  if (fileNames.isEmpty()) {
+    return;
+  }
+
+  auto *sourceGroup = new QActionGroup(sourceMenu_);
+  auto addSourceAction = [&](const QString &label, int source) {
+    QAction *action = sourceMenu_->addAction(label);
+    action->setCheckable(true);
+    action->setChecked(source < 0);
+    sourceGroup->addAction(action);
+    connect(action, &QAction::triggered, this, [this, source]() {
+      waterfallWidget_->setSourceFilter(source);
+    });
+  };
+
+  addSourceAction("&Combined", -1);
+  sourceMenu_->addSeparator();
+  for (int i = 0; i < fileNames.size(); ++i) {
+    addSourceAction(QFileInfo(fileNames[i]).fileName(), i);
+  }
+}
+
+void MainWindow::compareData()
+{
+  const QString baselineFile = QFileDialog::getOpenFileName(
+      this, "Open Baseline CSV File", "", "CSV Files (*.csv);;All Files (*)");
+  if (baselineFile.isEmpty()) {
+    return;
+  }
+
+  const QString candidateFile = QFileDialog::getOpenFileName(
+      this, "Open Candidate CSV File", "", "CSV Files (*.csv);;All Files (*)");
+  if (candidateFile.isEmpty()) {
+    return;
+  }
+
+  if (isLiveCapture_) {
+    stopLiveCapture();
+  }
+  cancelLoading();
+
+  // The current view stays up until the comparison is ready
+  compareLoader_ = std::make_unique<CompareLoader>(
+      baselineFile, candidateFile, MAX_TIME_WINDOW_MS, waterfallWidget_->accumulationColumns());
+  showLoadProgress("Loading traces to compare...");
+  compareLoader_->start();
+  loadTimer_->start(30);
+}
+
+void MainWindow::updateFromCompareLoader()
+{
+  const int64_t totalBytes = std::max<int64_t>(compareLoader_->totalBytes(), 1);
+  loadProgress_->setValue(int(1000 * compareLoader_->bytesRead() / totalBytes));
+  if (!compareLoader_->isFinished()) {
+    return;
+  }
+
+  hideLoadProgress();
+  const bool canceled = compareLoader_->wasCanceled();
+  TraceComparison comparison = compareLoader_->takeComparison();
+  compareLoader_.reset();
+
+  if (canceled) {
+    statusBar()->showMessage("Comparison canceled");
+    return;
+  }
+  if (comparison.baseline.empty() || comparison.candidate.empty()) {
     QMessageBox::warning(this, "Error", "Failed to load data from file");
     return;
   }
 
-  waterfallWidget_->setData(events);
-  statusBar()->showMessage(QString("Loaded %1 events from CSV").arg(events.size()));
+  const size_t baselineCount = comparison.baseline.size();
+  const size_t candidateCount = comparison.candidate.size();
+  waterfallWidget_->setCompareData(std::move(comparison));
+
+  updateCompareTable();
+  updateSourceMenu({});
+  compareDock_->show();
+  statusBar()->showMessage(QString("Comparing %1 baseline events against %2 candidate events")
+                               .arg(baselineCount)
+                               .arg(candidateCount));
+}
+
+void MainWindow::updateCompareTable()
+{
+  const BucketTotals &baseline = waterfallWidget_->baselineTotals();
+  const BucketTotals &candidate = waterfallWidget_->candidateTotals();
+
+  for (int row = 0; row < int(SIZE_BUCKETS.size()); ++row) {
+    const qint64 baselineCount = qint64(baseline.counts[row]);
+    const qint64 candidateCount = qint64(candidate.counts[row]);
+    const qint64 deltaCount = candidateCount - baselineCount;
+    const qint64 deltaSize = qint64(candidate.sizes[row]) - qint64(baseline.sizes[row]);
+
+    const QString bucketLabel = row + 1 < int(SIZE_BUCKETS.size()) ?
+                                    QString("<= %1").arg(SIZE_BUCKETS[row]) :
+                                    QString("> %1").arg(SIZE_BUCKETS[row - 1]);
+    const QString percentLabel = baselineCount > 0 ?
+                                     QString::number(100.0 * deltaCount / baselineCount, 'f', 1) :
+                                     QString(candidateCount > 0 ? "new" : "");
+
+    const QStringList cells = {bucketLabel,
+                               QString::number(baselineCount),
+                               QString::number(candidateCount),
+                               QString::number(deltaCount),
+                               percentLabel,
+                               QString::number(deltaSize)};
+    for (int column = 0; column < cells.size(); ++column) {
+      auto *item = new QTableWidgetItem(cells[column]);
+      if (column > 0) {
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+      }
+      compareTable_->setItem(row, column, item);
+    }
+  }
+
+  compareTable_->resizeColumnsToContents();
+}
+
+bool MainWindow::startCapture(LiveDataSource *source)
+{
+  if (aggregateAction_->isChecked()) {
+    // One histogram column per time bucket of the window. Columns are only
+    // read once events for them can no longer arrive.
+    const int numColumns = waterfallWidget_->accumulationColumns();
+    liveHistogram_ = std::make_unique<LiveHistogram>(
+        MAX_TIME_WINDOW_MS / numColumns, numColumns, source->lateEventsMs());
+  }
+  source->setHistogram(liveHistogram_.get());
+
+  if (!source->start()) {
+    source->setHistogram(nullptr);
+    liveHistogram_.reset();
+    return false;
+  }
+
+  liveSource_ = source;
+  isLiveCapture_ = true;
+  reportedBurstMs_ = -1.0;
+  recordAction_->setEnabled(true);
+  compareDock_->hide();
+  updateSourceMenu({});
+  waterfallWidget_->setLiveMode(true, source->lateEventsMs());
+  updateTimer_->start(30);
+  return true;
 }
 
 void MainWindow::startLiveCapture()
 {
+#ifdef _WIN32
   if (isLiveCapture_) {
     return;
   }
 
-  if (etwDataSource_->start()) {
-    isLiveCapture_ = true;
-    waterfallWidget_->setLiveMode(true);
-    updateTimer_->start(30);
-    statusBar()->showMessage("Live ETW capture active");
+  cancelLoading();
+
+  if (startCapture(etwDataSource_)) {
+    statusBar()->showMessage(liveHistogram_ ? "Live ETW capture active (aggregating at source)" :
+                                              "Live ETW capture active");
   }
   else {
     statusBar()->showMessage("Failed to start ETW capture");
   }
+#endif
+}
+
+void MainWindow::startReplay()
+{
+  const QString fileName = QFileDialog::getOpenFileName(
+      this, "Replay CSV File", "", "CSV Files (*.csv);;All Files (*)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  bool ok = false;
+  const double speed = QInputDialog::getDouble(
+      this, "Replay Speed", "Playback speed:", 1.0, 0.01, 1000.0, 2, &ok);
+  if (!ok) {
+    return;
+  }
+
+  if (isLiveCapture_) {
+    stopLiveCapture();
+  }
+  cancelLoading();
+
+  replayDataSource_ = std::make_unique<ReplayDataSource>(fileName, speed);
+  if (startCapture(replayDataSource_.get())) {
+    const QString message = liveHistogram_ ? "Replaying %1 at %2x (aggregating at source)" :
+                                             "Replaying %1 at %2x";
+    statusBar()->showMessage(message.arg(QFileInfo(fileName).fileName()).arg(speed));
+  }
+  else {
+    replayDataSource_.reset();
+    QMessageBox::warning(this, "Error", "Failed to open file for replay");
+  }
+}
+
+void MainWindow::startSocketCapture()
+{
+#ifdef __linux__
+  bool ok = false;
+  const QString socketPath = QInputDialog::getText(this,
+                                                   "Listen on Socket",
+                                                   "Socket path:",
+                                                   QLineEdit::Normal,
+                                                   INGEST_DEFAULT_SOCKET_PATH,
+                                                   &ok);
+  if (!ok || socketPath.isEmpty()) {
+    return;
+  }
+
+  if (isLiveCapture_) {
+    stopLiveCapture();
+  }
+  cancelLoading();
+
+  socketDataSource_ = std::make_unique<SocketDataSource>(socketPath);
+  if (startCapture(socketDataSource_.get())) {
+    ingestLatencyMs_ = 0.0;
+    latencySendTimeNs_ = 0;
+    statusBar()->showMessage(QString("Listening on %1").arg(socketPath));
+  }
+  else {
+    QMessageBox::warning(this, "Error", socketDataSource_->errorString());
+    socketDataSource_.reset();
+  }
+#endif
 }
 
 void MainWindow::stopLiveCapture()
@@ -107,20 +575,283 @@ void MainWindow::stopLiveCapture()
   }
 
   updateTimer_->stop();
-  etwDataSource_->stop();
+  liveSource_->stop();
+  liveSource_->setHistogram(nullptr);
+  liveSource_->setRecorder(nullptr);
+  liveSource_ = nullptr;
+  liveHistogram_.reset();
   isLiveCapture_ = false;
+  recordAction_->setEnabled(false);
   waterfallWidget_->setLiveMode(false);
-  statusBar()->showMessage("Live capture stopped");
+
+  if (!recorder_) {
+    statusBar()->showMessage("Live capture stopped");
+    return;
+  }
+
+  recorder_->close();
+  const QString message = recorder_->failed() ?
+                              "Live capture stopped, failed writing %1 after %2 events" :
+                              "Live capture stopped, recorded %2 events to %1";
+  statusBar()->showMessage(message.arg(QFileInfo(recorder_->filePath()).fileName())
+                               .arg(recorder_->eventsWritten()));
+  recorder_.reset();
 }
 
-void MainWindow::updateFromETW()
+void MainWindow::startRecording()
+{
+  if (!isLiveCapture_ || recorder_) {
+    return;
+  }
+
+  const QString fileName = QFileDialog::getSaveFileName(
+      this, "Record to CSV File", "", "CSV Files (*.csv);;All Files (*)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  recorder_ = std::make_unique<TraceRecorder>(QFileInfo(fileName).filesystemFilePath());
+  if (!recorder_->open()) {
+    recorder_.reset();
+    QMessageBox::warning(this, "Error", "Failed to open file for recording");
+    return;
+  }
+
+  liveSource_->setRecorder(recorder_.get());
+  recordAction_->setEnabled(false);
+  statusBar()->showMessage(QString("Recording to %1").arg(QFileInfo(fileName).fileName()));
+}
+
+void MainWindow::updateFromLiveSource()
 {
   if (!isLiveCapture_) {
     return;
   }
 
-  const double currentTime = etwDataSource_->getElapsedTimeMs();
-  waterfallWidget_->updateLiveData(currentTime, [this](AllocationEvents &events) {
-    etwDataSource_->getRecentEvents(30000.0, events);
-  });
+  const double currentTime = liveSource_->getElapsedTimeMs();
+  if (liveHistogram_) {
+    waterfallWidget_->updateLiveHistogram(*liveHistogram_, currentTime);
+  }
+  else {
+    waterfallWidget_->updateLiveData(currentTime, [this](AllocationEvents &events) {
+      liveSource_->getRecentEvents(MAX_TIME_WINDOW_MS, events);
+    });
+  }
+
+  reportNewBursts();
+
+#ifdef __linux__
+  if (liveSource_ == socketDataSource_.get() && !socketDataSource_->isRunning()) {
+    stopLiveCapture();
+    QMessageBox::warning(this, "Error", socketDataSource_->errorString());
+    return;
+  }
+  if (liveSource_ == socketDataSource_.get()) {
+    // Time from a producer sending a batch until the waterfall has been
+    // redrawn with it, smoothed over recent batches. Aggregated captures only
+    // draw a column once it is finished, so a batch is timed until then.
+    if (latencySendTimeNs_ == 0) {
+      socketDataSource_->takeLatestBatch(latencySendTimeNs_, latencyEventMs_);
+    }
+    double drawnEndMs = currentTime;
+    if (liveHistogram_) {
+      drawnEndMs = double(liveHistogram_->finishedColumnEnd(currentTime)) *
+                   liveHistogram_->columnMs();
+    }
+    if (latencySendTimeNs_ != 0 && latencyEventMs_ < drawnEndMs) {
+      const double latencyMs = double(IngestClockNs() - latencySendTimeNs_) / 1e6;
+      ingestLatencyMs_ = ingestLatencyMs_ > 0.0 ? 0.9 * ingestLatencyMs_ + 0.1 * latencyMs :
+                                                  latencyMs;
+      latencySendTimeNs_ = 0;
+    }
+    statusBar()->showMessage(QString("Listening on %1: %2 producer(s), %3 ms send to display")
+                                 .arg(socketDataSource_->socketPath())
+                                 .arg(socketDataSource_->numConnections())
+                                 .arg(ingestLatencyMs_, 0, 'f', 1));
+  }
+#endif
+}
+
+void MainWindow::reportNewBursts()
+{
+  const Bookmarks &bookmarks = waterfallWidget_->bookmarks();
+  if (bookmarks.empty() || bookmarks.back().timeMs <= reportedBurstMs_) {
+    return;
+  }
+
+  const Bookmark &burst = bookmarks.back();
+  reportedBurstMs_ = burst.timeMs;
+  const SizeBucketScheme &sizes = waterfallWidget_->shownSizeBuckets();
+  const QString bucketLabel = burst.sizeBucket + 1 < sizes.size() ?
+                                  QString("<= %1").arg(sizes.limitBytes(burst.sizeBucket)) :
+                                  QString("> %1").arg(sizes.limitBytes(burst.sizeBucket));
+  statusBar()->showMessage(
+      QString("Allocation burst at %1 s in %2 bytes: %3 per bucket, usually %4")
+          .arg(burst.timeMs / 1000.0, 0, 'f', 2)
+          .arg(bucketLabel)
+          .arg(burst.count)
+          .arg(burst.baseline, 0, 'f', 1),
+      5000);
+}
+
+void MainWindow::exportBookmarks()
+{
+  const Bookmarks &bookmarks = waterfallWidget_->bookmarks();
+  if (bookmarks.empty()) {
+    QMessageBox::information(this, "Export Bookmarks", "No bursts have been detected");
+    return;
+  }
+
+  const QString fileName = QFileDialog::getSaveFileName(
+      this, "Export Bookmarks", "", "CSV Files (*.csv);;All Files (*)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  if (!ExportBookmarks(QFileInfo(fileName).filesystemFilePath(),
+                       bookmarks,
+                       waterfallWidget_->shownSizeBuckets()))
+  {
+    QMessageBox::warning(this, "Error", "Failed to export bookmarks");
+    return;
+  }
+  statusBar()->showMessage(QString("Exported %1 bookmarks").arg(bookmarks.size()));
+}
+
+void MainWindow::recommendSizeClasses()
+{
+  // The recommendation reads the shown events in place, so they must not change meanwhile
+  if (loader_ || compareLoader_ || sizeClassLoader_ || isLiveCapture_) {
+    QMessageBox::information(this,
+                             "Recommend Size Classes",
+                             "Wait for loading to finish and stop any live capture first");
+    return;
+  }
+
+  bool ok = false;
+  const int numClasses = QInputDialog::getInt(this,
+                                              "Recommend Size Classes",
+                                              "Number of size classes:",
+                                              16,
+                                              1,
+                                              SizeBucketScheme::MaxSize - 1,
+                                              1,
+                                              &ok);
+  if (!ok) {
+    return;
+  }
+
+  SizeClassOptions options;
+  options.maxClasses = numClasses;
+  sizeClassLoader_ = std::make_unique<SizeClassLoader>(waterfallWidget_->sizeDistributionQuery(),
+                                                       options,
+                                                       waterfallWidget_->sizeBuckets().limits(),
+                                                       [this]() { emit sizeClassesReady(); });
+  showLoadProgress("Recommending size classes...");
+  sizeClassLoader_->start();
+  loadTimer_->start(30);
+}
+
+void MainWindow::updateFromSizeClassLoader()
+{
+  // The signal of a loader canceled meanwhile can still arrive
+  if (!sizeClassLoader_) {
+    return;
+  }
+
+  const int64_t totalEvents = std::max<int64_t>(sizeClassLoader_->totalEvents(), 1);
+  loadProgress_->setValue(int(1000 * sizeClassLoader_->eventsRead() / totalEvents));
+  if (!sizeClassLoader_->isFinished()) {
+    return;
+  }
+
+  hideLoadProgress();
+  const bool canceled = sizeClassLoader_->wasCanceled();
+  const SizeClassResult result = sizeClassLoader_->takeResult();
+  sizeClassLoader_.reset();
+
+  if (canceled) {
+    statusBar()->showMessage("Size class recommendation canceled");
+    return;
+  }
+
+  const SizeClassRecommendation &recommendation = result.recommendation;
+  if (recommendation.plans.empty()) {
+    QMessageBox::information(this, "Recommend Size Classes", "No allocations are shown");
+    return;
+  }
+
+  auto percentOfPooled = [&](uint64_t wastedBytes) {
+    return 100.0 * double(wastedBytes) / double(std::max<uint64_t>(recommendation.pooledBytes, 1));
+  };
+
+  const SizeClassPlan &plan = recommendation.plans.back();
+  QStringList limits;
+  for (const size_t limit : plan.limits) {
+    limits.append(QString::number(limit));
+  }
+  // Waste for every smaller class count too, to show where more classes stop paying off
+  QStringList candidates;
+  for (size_t n = 1; n <= recommendation.plans.size(); ++n) {
+    const uint64_t wastedBytes = recommendation.plans[n - 1].wastedBytes;
+    candidates.append(QString("%1: %2%").arg(n).arg(percentOfPooled(wastedBytes), 0, 'f', 1));
+  }
+  const uint64_t currentWaste = result.currentWastedBytes;
+
+  const QString text =
+      QString(
+          "%1 classes for %2 shown allocations:\n%3\n\nWasted: %4 bytes (%5% of the requested "
+          "bytes), currently %6 bytes (%7%)\n\nWasted by number of classes:\n%8\n\nApply "
+          "the classes as size buckets?")
+          .arg(plan.limits.size())
+          .arg(result.totalCount)
+          .arg(limits.join(", "))
+          .arg(plan.wastedBytes)
+          .arg(percentOfPooled(plan.wastedBytes), 0, 'f', 1)
+          .arg(currentWaste)
+          .arg(percentOfPooled(currentWaste), 0, 'f', 1)
+          .arg(candidates.join("  "));
+  const QMessageBox::StandardButton answer = QMessageBox::question(
+      this,
+      "Recommend Size Classes",
+      text,
+      QMessageBox::Apply | QMessageBox::Save | QMessageBox::Cancel);
+
+  if (answer == QMessageBox::Apply) {
+    waterfallWidget_->setSizeBuckets(SizeBucketScheme(plan.limits));
+  }
+  else if (answer == QMessageBox::Save) {
+    const QString fileName = QFileDialog::getSaveFileName(
+        this, "Save Size Classes", "", "Text Files (*.txt);;All Files (*)");
+    if (!fileName.isEmpty() &&
+        !WriteSizeClasses(QFileInfo(fileName).filesystemFilePath(), plan.limits))
+    {
+      QMessageBox::warning(this, "Error", "Failed to save size classes");
+    }
+  }
+}
+
+void MainWindow::loadSizeClasses()
+{
+  const QString fileName = QFileDialog::getOpenFileName(
+      this, "Load Size Classes", "", "Text Files (*.txt);;All Files (*)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  std::vector<size_t> limits;
+  if (!ReadSizeClasses(QFileInfo(fileName).filesystemFilePath(), limits)) {
+    QMessageBox::warning(this, "Error", "Failed to load size classes from file");
+    return;
+  }
+
+  const SizeBucketScheme sizes(std::move(limits));
+  if (sizes.size() > SizeBucketScheme::MaxSize) {
+    QMessageBox::warning(
+        this,
+        "Error",
+        QString("At most %1 size classes are supported").arg(SizeBucketScheme::MaxSize - 1));
+    return;
+  }
+  waterfallWidget_->setSizeBuckets(sizes);
 }
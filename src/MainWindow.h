@@ -3,12 +3,30 @@
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #pragma once
 
-#include "ETWDataSource.h"
+#include "DataSource.h"
+#include "LiveHistogram.h"
+#include "ReplayDataSource.h"
+#include "TraceLoader.h"
+#include "TraceRecorder.h"
 #include "WaterfallWidget.h"
 
+#ifdef _WIN32
+#  include "ETWDataSource.h"
+#endif
+#ifdef __linux__
+#  include "SocketDataSource.h"
+#endif
+
+#include <QDockWidget>
 #include <QMainWindow>
+#include <QMenu>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QTableWidget>
 #include <QTimer>
 
+#include <memory>
+
 class MainWindow : public QMainWindow {
   Q_OBJECT
 
@@ -16,15 +34,68 @@ class MainWindow : public QMainWindow {
   explicit MainWindow(QWidget *parent = nullptr);
   ~MainWindow() final;
 
+ signals:
+  // Emitted from the worker thread of the size class loader once it is done
+  void sizeClassesReady();
+
  private slots:
   void loadData();
+  void loadMergedData();
+  void compareData();
+  void cancelLoading();
+  void updateFromLoader();
   void startLiveCapture();
+  void startReplay();
+  void startSocketCapture();
   void stopLiveCapture();
-  void updateFromETW();
+  void startRecording();
+  void exportBookmarks();
+  void recommendSizeClasses();
+  void loadSizeClasses();
+  void updateFromLiveSource();
 
  private:
+  void startLoading(const QStringList &fileNames);
+  void showLoadProgress(const QString &message);
+  void hideLoadProgress();
+  void updateFromCompareLoader();
+  void updateFromSizeClassLoader();
+  void updateCompareTable();
+  void updateSourceMenu(const QStringList &fileNames);
+  void reportNewBursts();
+  bool startCapture(LiveDataSource *source);
+
   WaterfallWidget *waterfallWidget_;
-  ETWDataSource *etwDataSource_;
+  QDockWidget *compareDock_;
+  QTableWidget *compareTable_;
+  QMenu *sourceMenu_;
+  QProgressBar *loadProgress_;
+  QPushButton *cancelLoadButton_;
+  QAction *cancelLoadAction_;
+  QTimer *loadTimer_;
+  std::unique_ptr<TraceLoader> loader_;
+  std::unique_ptr<CompareLoader> compareLoader_;
+  std::unique_ptr<SizeClassLoader> sizeClassLoader_;
+  QStringList loadingFileNames_;
+  size_t loadedEventCount_ = 0;
+#ifdef _WIN32
+  ETWDataSource *etwDataSource_ = nullptr;
+#endif
+  std::unique_ptr<ReplayDataSource> replayDataSource_;
+#ifdef __linux__
+  std::unique_ptr<SocketDataSource> socketDataSource_;
+  double ingestLatencyMs_ = 0.0;
+  // Batch whose send to display time is being measured, 0 if none
+  uint64_t latencySendTimeNs_ = 0;
+  double latencyEventMs_ = 0.0;
+#endif
+  LiveDataSource *liveSource_ = nullptr;
+  std::unique_ptr<LiveHistogram> liveHistogram_;
+  std::unique_ptr<TraceRecorder> recorder_;
+  QAction *aggregateAction_;
+  QAction *recordAction_;
+  // Start of the newest burst already reported in the status bar
+  double reportedBurstMs_ = -1.0;
   QTimer *updateTimer_;
   bool isLiveCapture_;
 };
@@ -0,0 +1,166 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "MergedCSVDataSource.h"
+#include "CSVDataSource.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace {
+
+// Parsed chunks from one file waiting to be merged. The parser blocks once
+// MaxQueuedChunks are waiting so a fast file cannot run far ahead of the merge.
+struct SourceQueue {
+  static constexpr size_t MaxQueuedChunks = 4;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<AllocationEvents> chunks;
+  bool finished = false;
+};
+
+struct SourceCursor {
+  AllocationEvents chunk;
+  size_t index = 0;
+};
+
+}  // namespace
+
+MergedCSVDataSource::MergedCSVDataSource(const std::vector<std::filesystem::path> &filePaths)
+    : filePaths_(filePaths)
+{
+}
+
+void MergedCSVDataSource::loadData(AllocationEvents &events, AllocationSources &sources) const
+{
+  events.clear();
+  sources.clear();
+
+  readChunks(CSVDataSource::ChunkSize,
+             [&](const AllocationEvents &chunkEvents, const AllocationSources &chunkSources) {
+               events.insert(events.end(), chunkEvents.begin(), chunkEvents.end());
+               sources.insert(sources.end(), chunkSources.begin(), chunkSources.end());
+               return true;
+             });
+}
+
+bool MergedCSVDataSource::readChunks(size_t chunkSize,
+                                     const ChunkCallback &fn,
+                                     std::atomic<int64_t> *bytesRead) const
+{
+  const int numSources = int(filePaths_.size());
+  std::vector<SourceQueue> queues(numSources);
+  std::atomic<bool> stop = false;
+
+  std::vector<std::thread> parsers;
+  parsers.reserve(numSources);
+  for (int i = 0; i < numSources; ++i) {
+    parsers.emplace_back([&, i]() {
+      SourceQueue &queue = queues[i];
+      auto enqueue = [&](const AllocationEvents &chunk) {
+        std::unique_lock lock(queue.mutex);
+        queue.cv.wait(lock, [&]() {
+          return queue.chunks.size() < SourceQueue::MaxQueuedChunks || stop;
+        });
+        if (stop) {
+          return false;
+        }
+        queue.chunks.push_back(chunk);
+        queue.cv.notify_all();
+        return true;
+      };
+      CSVDataSource(filePaths_[i]).readChunks(chunkSize, enqueue, bytesRead);
+
+      std::lock_guard lock(queue.mutex);
+      queue.finished = true;
+      queue.cv.notify_all();
+    });
+  }
+
+  // Moves the cursor of `source` to its next chunk, waiting for the parser if
+  // needed. Returns false once the file is exhausted.
+  std::vector<SourceCursor> cursors(numSources);
+  auto nextChunk = [&](int source) {
+    SourceQueue &queue = queues[source];
+    std::unique_lock lock(queue.mutex);
+    queue.cv.wait(lock, [&]() { return !queue.chunks.empty() || queue.finished; });
+    if (queue.chunks.empty()) {
+      return false;
+    }
+
+    cursors[source].chunk = std::move(queue.chunks.front());
+    cursors[source].index = 0;
+    queue.chunks.pop_front();
+    queue.cv.notify_all();
+    return true;
+  };
+
+  // Min-heap of (next event time, source). Ties go to the lower source index.
+  using HeapEntry = std::pair<double, int>;
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<>> heap;
+  for (int i = 0; i < numSources; ++i) {
+    if (nextChunk(i)) {
+      heap.push({cursors[i].chunk.front().timeMs, i});
+    }
+  }
+
+  AllocationEvents events;
+  AllocationSources sources;
+  events.reserve(chunkSize);
+  sources.reserve(chunkSize);
+
+  bool keepGoing = true;
+  while (keepGoing && !heap.empty()) {
+    const int source = heap.top().second;
+    heap.pop();
+
+    // Emit the whole run of events from this source that precede every other
+    // source, which skips the heap entirely for long non-overlapping stretches.
+    SourceCursor &cursor = cursors[source];
+    const double limitMs = heap.empty() ? std::numeric_limits<double>::infinity() :
+                                          heap.top().first;
+    bool exhausted = false;
+    do {
+      events.push_back(cursor.chunk[cursor.index]);
+      sources.push_back(uint16_t(source));
+
+      if (++cursor.index == cursor.chunk.size() && !nextChunk(source)) {
+        exhausted = true;
+      }
+
+      if (events.size() >= chunkSize) {
+        keepGoing = fn(events, sources);
+        events.clear();
+        sources.clear();
+      }
+    } while (keepGoing && !exhausted && cursor.chunk[cursor.index].timeMs < limitMs);
+
+    if (!exhausted) {
+      heap.push({cursor.chunk[cursor.index].timeMs, source});
+    }
+  }
+
+  if (keepGoing && !events.empty()) {
+    keepGoing = fn(events, sources);
+  }
+
+  if (!keepGoing) {
+    stop = true;
+    for (SourceQueue &queue : queues) {
+      std::lock_guard lock(queue.mutex);
+      queue.cv.notify_all();
+    }
+  }
+
+  for (std::thread &parser : parsers) {
+    parser.join();
+  }
+
+  return keepGoing;
+}
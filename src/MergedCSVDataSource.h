@@ -0,0 +1,36 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+// Reads several time-ordered CSV traces (e.g. one per process) as a single
+// time-ordered stream. Each file is parsed on its own thread into a small
+// bounded queue of chunks, and the queues are combined with a k-way merge, so
+// no file has to be fully parsed before events from the others are produced.
+class MergedCSVDataSource {
+ public:
+  // Return false from the callback to stop reading early.
+  using ChunkCallback =
+      std::function<bool(const AllocationEvents &chunk, const AllocationSources &sources)>;
+
+  explicit MergedCSVDataSource(const std::vector<std::filesystem::path> &filePaths);
+  void loadData(AllocationEvents &events, AllocationSources &sources) const;
+
+  // Produces at most `chunkSize` merged events at a time, along with the index
+  // of the file each event came from. The number of bytes consumed across all
+  // files is added to `bytesRead` when given. Returns false if reading was stopped.
+  bool readChunks(size_t chunkSize,
+                  const ChunkCallback &fn,
+                  std::atomic<int64_t> *bytesRead = nullptr) const;
+
+ private:
+  std::vector<std::filesystem::path> filePaths_;
+};
@@ -0,0 +1,125 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "ReplayDataSource.h"
+#include "CSVDataSource.h"
+#include "LiveHistogram.h"
+#include "TraceRecorder.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+
+ReplayDataSource::ReplayDataSource(const QString &filePath, double speed)
+    : filePath_(filePath), speed_(std::max(speed, 0.001))
+{
+}
+
+ReplayDataSource::~ReplayDataSource()
+{
+  stop();
+}
+
+bool ReplayDataSource::start()
+{
+  if (running_) {
+    return true;
+  }
+
+  if (!QFileInfo(filePath_).isReadable()) {
+    return false;
+  }
+
+  events_.clear();
+
+  stopping_ = false;
+  finished_ = false;
+  startTime_ = std::chrono::steady_clock::now();
+  replayThread_ = std::thread(&ReplayDataSource::replay, this);
+  running_ = true;
+  return true;
+}
+
+void ReplayDataSource::stop()
+{
+  if (!running_) {
+    return;
+  }
+
+  stopping_ = true;
+  if (replayThread_.joinable()) {
+    replayThread_.join();
+  }
+  running_ = false;
+}
+
+double ReplayDataSource::getElapsedTimeMs() const
+{
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() -
+                                                            startTime_;
+  return elapsed.count() * speed_;
+}
+
+void ReplayDataSource::replay()
+{
+  bool haveFirstTimestamp = false;
+  double firstTimestampMs = 0.0;
+  AllocationEvents batch;
+
+  auto flush = [&]() {
+    if (batch.empty()) {
+      return;
+    }
+
+    if (TraceRecorder *recorder = recorder_.load(std::memory_order_acquire)) {
+      recorder->append(batch.data(), batch.size());
+    }
+
+    if (histogram_) {
+      for (const AllocationEvent &event : batch) {
+        histogram_->record(event.timeMs, event.size);
+      }
+    }
+    else {
+      events_.append(batch);
+    }
+    batch.clear();
+  };
+
+  const CSVDataSource source(QFileInfo(filePath_).filesystemFilePath());
+  source.readChunks(CSVDataSource::ChunkSize, [&](const AllocationEvents &chunk) {
+    for (const AllocationEvent &event : chunk) {
+      if (!haveFirstTimestamp) {
+        firstTimestampMs = event.timeMs;
+        haveFirstTimestamp = true;
+      }
+      const double timeMs = std::max(event.timeMs - firstTimestampMs, 0.0);
+
+      // Hand over everything that is due, then wait for the next event in
+      // small steps so that stop() is not held up by gaps in the trace.
+      double nowMs = getElapsedTimeMs();
+      while (timeMs > nowMs) {
+        flush();
+        if (stopping_) {
+          return false;
+        }
+        const double waitMs = std::min((timeMs - nowMs) / speed_, 10.0);
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(waitMs));
+        nowMs = getElapsedTimeMs();
+      }
+
+      batch.push_back(AllocationEvent{timeMs, event.size});
+    }
+
+    flush();
+    return !stopping_;
+  });
+
+  flush();
+  finished_ = true;
+}
+
+void ReplayDataSource::getRecentEvents(double maxAgeMs, AllocationEvents &recent) const
+{
+  events_.getRecentEvents(getElapsedTimeMs() - maxAgeMs, recent);
+}
@@ -0,0 +1,57 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+#include "LiveEventBuffer.h"
+
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Plays a CSV trace back in real time, scaled by `speed`, as if it were being
+// captured live. Event times are rebased so the first event happens at start.
+class ReplayDataSource : public LiveDataSource {
+ public:
+  explicit ReplayDataSource(const QString &filePath, double speed = 1.0);
+  ~ReplayDataSource() final;
+
+  bool start() final;
+  void stop() final;
+  bool isRunning() const final
+  {
+    return running_;
+  }
+
+  double getElapsedTimeMs() const final;
+
+  void getRecentEvents(double maxAgeMs, AllocationEvents &recent) const final;
+
+  // Events are handed over as they come due, in steps of at most 10 ms
+  double lateEventsMs() const final
+  {
+    return 20.0;
+  }
+
+  // True once the whole trace has been played back.
+  bool isFinished() const
+  {
+    return finished_;
+  }
+
+ private:
+  void replay();
+
+  QString filePath_;
+  double speed_;
+  std::chrono::steady_clock::time_point startTime_;
+  std::thread replayThread_;
+  std::atomic<bool> stopping_ = false;
+  std::atomic<bool> finished_ = false;
+  bool running_ = false;
+
+  mutable LiveEventBuffer events_;
+};
@@ -0,0 +1,84 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+constexpr std::array<size_t, 36> SIZE_BUCKETS = {
+    8,     16,    32,    48,    64,    80,    96,    112,    128,    160,    192,     224,
+    256,   320,   384,   448,   512,   640,   768,   896,    1024,   2048,   4096,    8192,
+    16384, 24576, 32768, 49152, 65536, 81920, 98304, 114688, 131072, 524288, 2097152, ULLONG_MAX};
+
+constexpr int GetSizeBucketIndex(size_t size)
+{
+  const auto index = std::lower_bound(SIZE_BUCKETS.begin(), SIZE_BUCKETS.end(), size);
+  return int(std::distance(SIZE_BUCKETS.begin(), index));
+}
+
+// Size bucket limits chosen at runtime, such as recommended pool size classes.
+// Each bucket holds the sizes up to and including its limit, and the last
+// limit is always ULLONG_MAX. Defaults to SIZE_BUCKETS.
+class SizeBucketScheme {
+ public:
+  // Sparse histograms track the occupied size buckets of a time bucket in a
+  // 64-bit mask. More buckets would also leave each only a few pixels.
+  static constexpr int MaxSize = 64;
+
+  SizeBucketScheme() : limits_(SIZE_BUCKETS.begin(), SIZE_BUCKETS.end()) {}
+
+  // Limits are sorted and deduplicated, and a final catch-all bucket is added if missing.
+  explicit SizeBucketScheme(std::vector<size_t> limits) : limits_(std::move(limits))
+  {
+    std::sort(limits_.begin(), limits_.end());
+    limits_.erase(std::unique(limits_.begin(), limits_.end()), limits_.end());
+    if (limits_.empty() || limits_.back() != ULLONG_MAX) {
+      limits_.push_back(ULLONG_MAX);
+    }
+  }
+
+  static const SizeBucketScheme &Default()
+  {
+    static const SizeBucketScheme scheme;
+    return scheme;
+  }
+
+  int indexOf(size_t size) const
+  {
+    const auto index = std::lower_bound(limits_.begin(), limits_.end(), size);
+    return int(std::distance(limits_.begin(), index));
+  }
+
+  int size() const
+  {
+    return int(limits_.size());
+  }
+
+  // Smallest size that falls into bucket `index`.
+  size_t minBytes(int index) const
+  {
+    return index == 0 ? 0 : limits_[index - 1] + 1;
+  }
+
+  // The last bucket has no upper bound; this reports it by its lower one.
+  size_t limitBytes(int index) const
+  {
+    return index + 1 < size() || index == 0 ? limits_[index] : limits_[index - 1];
+  }
+
+  const std::vector<size_t> &limits() const
+  {
+    return limits_;
+  }
+
+  bool operator==(const SizeBucketScheme &other) const = default;
+
+ private:
+  std::vector<size_t> limits_;
+};
@@ -0,0 +1,324 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "SizeClasses.h"
+#include "Histogram.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+
+// Split points kept for reconstructing every plan; limits the distinct sizes
+// the dynamic program works on to MAX_DP_CELLS / maxClasses
+constexpr size_t MAX_DP_CELLS = 16 * 1024 * 1024;
+
+// Events counted between checks for cancellation
+constexpr size_t CANCEL_CHECK_EVENTS = 64 * 1024;
+
+uint64_t SizeDistribution::totalCount() const
+{
+  uint64_t total = 0;
+  for (const uint64_t count : counts) {
+    total += count;
+  }
+  return total;
+}
+
+uint64_t SizeDistribution::totalBytes() const
+{
+  uint64_t total = 0;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    total += uint64_t(sizes[i]) * counts[i];
+  }
+  return total;
+}
+
+SizeDistributionBuilder::SizeDistributionBuilder() : small_(DirectCountLimit, 0) {}
+
+void SizeDistributionBuilder::mergeRuns(const SizeDistribution &runs)
+{
+  SizeDistribution merged;
+  merged.sizes.reserve(large_.sizes.size() + runs.sizes.size());
+  merged.counts.reserve(large_.sizes.size() + runs.sizes.size());
+
+  size_t a = 0;
+  size_t b = 0;
+  while (a < large_.sizes.size() || b < runs.sizes.size()) {
+    const bool takeA = b == runs.sizes.size() ||
+                       (a < large_.sizes.size() && large_.sizes[a] <= runs.sizes[b]);
+    const size_t size = takeA ? large_.sizes[a] : runs.sizes[b];
+    const uint64_t count = takeA ? large_.counts[a++] : runs.counts[b++];
+    if (!merged.sizes.empty() && merged.sizes.back() == size) {
+      merged.counts.back() += count;
+    }
+    else {
+      merged.sizes.push_back(size);
+      merged.counts.push_back(count);
+    }
+  }
+
+  large_ = std::move(merged);
+}
+
+void SizeDistributionBuilder::compact()
+{
+  if (pending_.empty()) {
+    return;
+  }
+
+  std::sort(pending_.begin(), pending_.end());
+  SizeDistribution runs;
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    if (i > 0 && pending_[i] == pending_[i - 1]) {
+      runs.counts.back()++;
+    }
+    else {
+      runs.sizes.push_back(pending_[i]);
+      runs.counts.push_back(1);
+    }
+  }
+  pending_.clear();
+
+  mergeRuns(runs);
+}
+
+void SizeDistributionBuilder::merge(SizeDistributionBuilder &other)
+{
+  for (size_t size = 0; size < DirectCountLimit; ++size) {
+    small_[size] += other.small_[size];
+  }
+  other.compact();
+  mergeRuns(other.large_);
+}
+
+SizeDistribution SizeDistributionBuilder::finish()
+{
+  compact();
+
+  SizeDistribution distribution;
+  for (size_t size = 0; size < DirectCountLimit; ++size) {
+    if (small_[size] > 0) {
+      distribution.sizes.push_back(size);
+      distribution.counts.push_back(small_[size]);
+    }
+  }
+  distribution.sizes.insert(distribution.sizes.end(), large_.sizes.begin(), large_.sizes.end());
+  distribution.counts.insert(
+      distribution.counts.end(), large_.counts.begin(), large_.counts.end());
+  return distribution;
+}
+
+SizeDistribution BuildSizeDistribution(const SizeDistributionQuery &query,
+                                       unsigned numThreads,
+                                       const std::atomic<bool> &canceled,
+                                       std::atomic<int64_t> &eventsRead)
+{
+  const AllocationEvents &events = *query.events;
+  std::vector<SizeDistributionBuilder> partials(EventSliceCount(events.size(), numThreads));
+  ForEachEventSlice(
+      events.size(), unsigned(partials.size()), [&](unsigned slice, size_t first, size_t last) {
+        for (size_t block = first; block < last && !canceled; block += CANCEL_CHECK_EVENTS) {
+          const size_t blockEnd = std::min(last, block + CANCEL_CHECK_EVENTS);
+          for (size_t e = block; e < blockEnd; ++e) {
+            const AllocationEvent &event = events[e];
+            if (event.timeMs >= query.startMs && event.timeMs <= query.endMs &&
+                (!query.sources || (*query.sources)[e] == query.source))
+            {
+              partials[slice].add(event.size);
+            }
+          }
+          eventsRead += int64_t(blockEnd - block);
+        }
+      });
+
+  for (size_t i = 1; i < partials.size(); ++i) {
+    partials[0].merge(partials[i]);
+  }
+  return partials[0].finish();
+}
+
+// The distribution after rounding sizes up to the alignment: every candidate
+// class limit, with prefix sums of the requests at or below it.
+struct AlignedPoints {
+  std::vector<size_t> limits;
+  // Index 0 is empty, index j covers limits[0..j-1]
+  std::vector<double> prefixCount = {0.0};
+  std::vector<double> prefixBytes = {0.0};
+};
+
+static AlignedPoints AlignPoints(const SizeDistribution &distribution,
+                                 size_t alignment,
+                                 size_t maxPooledSize)
+{
+  AlignedPoints points;
+  for (size_t i = 0; i < distribution.sizes.size(); ++i) {
+    const size_t size = distribution.sizes[i];
+    if (maxPooledSize > 0 && size > maxPooledSize) {
+      break;
+    }
+    const size_t limit = std::max(alignment, (size + alignment - 1) / alignment * alignment);
+    const double count = double(distribution.counts[i]);
+    if (points.limits.empty() || points.limits.back() != limit) {
+      points.limits.push_back(limit);
+      points.prefixCount.push_back(points.prefixCount.back());
+      points.prefixBytes.push_back(points.prefixBytes.back());
+    }
+    points.prefixCount.back() += count;
+    points.prefixBytes.back() += count * double(size);
+  }
+  return points;
+}
+
+SizeClassRecommendation RecommendSizeClasses(const SizeDistribution &distribution,
+                                             const SizeClassOptions &options)
+{
+  SizeClassRecommendation result;
+  for (size_t i = 0; i < distribution.sizes.size(); ++i) {
+    const uint64_t bytes = uint64_t(distribution.sizes[i]) * distribution.counts[i];
+    if (options.maxPooledSize > 0 && distribution.sizes[i] > options.maxPooledSize) {
+      result.unpooledCount += distribution.counts[i];
+      result.unpooledBytes += bytes;
+    }
+    else {
+      result.pooledCount += distribution.counts[i];
+      result.pooledBytes += bytes;
+    }
+  }
+
+  const size_t maxClasses = size_t(std::max(options.maxClasses, 1));
+  size_t alignment = std::max<size_t>(options.alignment, 1);
+  AlignedPoints points = AlignPoints(distribution, alignment, options.maxPooledSize);
+  while (points.limits.size() * maxClasses > MAX_DP_CELLS) {
+    alignment *= 2;
+    points = AlignPoints(distribution, alignment, options.maxPooledSize);
+  }
+  result.alignment = alignment;
+
+  const int numPoints = int(points.limits.size());
+  const int numPlans = int(std::min(maxClasses, points.limits.size()));
+  if (numPoints == 0) {
+    return result;
+  }
+
+  // Waste of one class serving points i..j-1, i.e. every request above
+  // limits[i - 1] up to limits[j - 1]
+  auto cost = [&](int i, int j) {
+    return double(points.limits[j - 1]) * (points.prefixCount[j] - points.prefixCount[i]) -
+           (points.prefixBytes[j] - points.prefixBytes[i]);
+  };
+
+  // best[j] is the least waste covering the first j points with k classes,
+  // and splits[k - 1][j] is where its last class starts.
+  constexpr double Infinity = std::numeric_limits<double>::infinity();
+  std::vector<double> previous(numPoints + 1, Infinity);
+  std::vector<double> best(numPoints + 1, Infinity);
+  std::vector<std::vector<int>> splits(numPlans, std::vector<int>(numPoints + 1, 0));
+  previous[0] = 0.0;
+
+  for (int k = 1; k <= numPlans; ++k) {
+    std::vector<int> &split = splits[k - 1];
+    std::fill(best.begin(), best.end(), Infinity);
+
+    // The best split point never moves left as j grows, so each half of the
+    // range only searches its side of the middle's split point.
+    auto solve = [&](auto &self, int lo, int hi, int splitLo, int splitHi) -> void {
+      if (lo > hi) {
+        return;
+      }
+      const int mid = (lo + hi) / 2;
+      int bestSplit = splitLo;
+      for (int i = splitLo; i <= std::min(mid - 1, splitHi); ++i) {
+        const double waste = previous[i] + cost(i, mid);
+        if (waste < best[mid]) {
+          best[mid] = waste;
+          bestSplit = i;
+        }
+      }
+      split[mid] = bestSplit;
+      self(self, lo, mid - 1, splitLo, bestSplit);
+      self(self, mid + 1, hi, bestSplit, splitHi);
+    };
+    solve(solve, k, numPoints, k - 1, numPoints - 1);
+
+    SizeClassPlan plan;
+    for (int j = numPoints, level = k; level > 0; j = splits[level - 1][j], --level) {
+      plan.limits.push_back(points.limits[j - 1]);
+    }
+    std::reverse(plan.limits.begin(), plan.limits.end());
+    plan.wastedBytes = WastedBytes(distribution, plan.limits, options.maxPooledSize);
+    result.plans.push_back(std::move(plan));
+
+    std::swap(previous, best);
+  }
+
+  return result;
+}
+
+uint64_t WastedBytes(const SizeDistribution &distribution,
+                     const std::vector<size_t> &limits,
+                     size_t maxPooledSize)
+{
+  // A catch-all last bucket is not a class
+  const auto classesEnd = !limits.empty() && limits.back() == ULLONG_MAX ? limits.end() - 1 :
+                                                                            limits.end();
+  uint64_t wasted = 0;
+  for (size_t i = 0; i < distribution.sizes.size(); ++i) {
+    const size_t size = distribution.sizes[i];
+    if (maxPooledSize > 0 && size > maxPooledSize) {
+      break;
+    }
+    const auto limit = std::lower_bound(limits.begin(), classesEnd, size);
+    if (limit == classesEnd) {
+      break;
+    }
+    wasted += uint64_t(*limit - size) * distribution.counts[i];
+  }
+  return wasted;
+}
+
+bool WriteSizeClasses(const std::filesystem::path &filePath, const std::vector<size_t> &limits)
+{
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file: %s\n", filePath.string().c_str());
+    return false;
+  }
+
+  file << "# Size classes in bytes, one per line\n";
+  for (const size_t limit : limits) {
+    file << limit << '\n';
+  }
+  file.close();
+  return bool(file);
+}
+
+bool ReadSizeClasses(const std::filesystem::path &filePath, std::vector<size_t> &limits)
+{
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file: %s\n", filePath.string().c_str());
+    return false;
+  }
+
+  limits.clear();
+  std::string line;
+  while (std::getline(file, line)) {
+    const size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    const size_t last = line.find_last_not_of(" \t\r") + 1;
+
+    unsigned long long limit = 0;
+    auto [end, error] = std::from_chars(line.data() + first, line.data() + last, limit);
+    if (error != std::errc() || end != line.data() + last || limit == 0) {
+      return false;
+    }
+    limits.push_back(size_t(limit));
+  }
+  return !limits.empty();
+}
@@ -0,0 +1,122 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Exact distribution of allocation sizes: the distinct sizes in increasing
+// order along with how often each was requested.
+struct SizeDistribution {
+  std::vector<size_t> sizes;
+  std::vector<uint64_t> counts;
+
+  uint64_t totalCount() const;
+  uint64_t totalBytes() const;
+};
+
+// Accumulates an exact size distribution one request at a time, in any order.
+// Small sizes are counted directly; larger ones are collected and periodically
+// sorted into runs, so memory depends on the number of distinct sizes.
+class SizeDistributionBuilder {
+ public:
+  static constexpr size_t DirectCountLimit = 64 * 1024;
+
+  SizeDistributionBuilder();
+
+  void add(size_t size)
+  {
+    if (size < DirectCountLimit) {
+      small_[size]++;
+      return;
+    }
+    pending_.push_back(size);
+    if (pending_.size() >= MaxPending) {
+      compact();
+    }
+  }
+
+  void merge(SizeDistributionBuilder &other);
+  SizeDistribution finish();
+
+ private:
+  static constexpr size_t MaxPending = 1024 * 1024;
+
+  void compact();
+  // Merges sorted distinct sizes with counts into large_
+  void mergeRuns(const SizeDistribution &runs);
+
+  std::vector<uint64_t> small_;
+  std::vector<size_t> pending_;
+  // Sorted distinct sizes from DirectCountLimit up
+  SizeDistribution large_;
+};
+
+// The events a distribution is built from: those within [startMs, endMs] and,
+// when `sources` is set, only those of `source`.
+struct SizeDistributionQuery {
+  const AllocationEvents *events = nullptr;
+  const AllocationSources *sources = nullptr;
+  int source = -1;
+  double startMs = 0.0;
+  double endMs = 0.0;
+};
+
+// Counts the sizes of the queried events across `numThreads` workers, adding
+// to `eventsRead` as it goes. Once `canceled` is set it stops early and the
+// distribution is incomplete.
+SizeDistribution BuildSizeDistribution(const SizeDistributionQuery &query,
+                                       unsigned numThreads,
+                                       const std::atomic<bool> &canceled,
+                                       std::atomic<int64_t> &eventsRead);
+
+struct SizeClassOptions {
+  // Largest number of classes to plan for; every count up to it is solved
+  int maxClasses = 32;
+  // Class sizes are multiples of this
+  size_t alignment = 8;
+  // Larger requests are left to the general purpose allocator, 0 for none
+  size_t maxPooledSize = 0;
+};
+
+// The best set of `limits.size()` size classes for a distribution. A request
+// is served by the smallest class that fits, and the difference is wasted.
+struct SizeClassPlan {
+  std::vector<size_t> limits;
+  uint64_t wastedBytes = 0;
+};
+
+struct SizeClassRecommendation {
+  // plans[n - 1] has n classes
+  std::vector<SizeClassPlan> plans;
+  uint64_t pooledCount = 0;
+  uint64_t pooledBytes = 0;
+  // Requests above maxPooledSize
+  uint64_t unpooledCount = 0;
+  uint64_t unpooledBytes = 0;
+  // Alignment actually used; it is raised when the distribution has too many
+  // distinct sizes to plan for in reasonable memory
+  size_t alignment = 0;
+};
+
+// Minimizes the count-weighted internal fragmentation for every number of
+// classes up to options.maxClasses. Dynamic program over the distinct aligned
+// sizes, with divide and conquer over the split points since the cost of a
+// class is Monge. O(maxClasses * D log D) for D distinct sizes.
+SizeClassRecommendation RecommendSizeClasses(const SizeDistribution &distribution,
+                                             const SizeClassOptions &options);
+
+// Bytes wasted serving the pooled part of `distribution` from classes
+// `limits`, such as the fixed SIZE_BUCKETS for reference.
+uint64_t WastedBytes(const SizeDistribution &distribution,
+                     const std::vector<size_t> &limits,
+                     size_t maxPooledSize = 0);
+
+// One limit per line; lines starting with '#' are comments.
+bool WriteSizeClasses(const std::filesystem::path &filePath, const std::vector<size_t> &limits);
+bool ReadSizeClasses(const std::filesystem::path &filePath, std::vector<size_t> &limits);
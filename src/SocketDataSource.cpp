@@ -0,0 +1,315 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "SocketDataSource.h"
+#include "IngestProtocol.h"
+#include "LiveHistogram.h"
+#include "TraceRecorder.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Enough for many small batches per read; grown to fit a larger batch as needed
+constexpr size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+constexpr int MAX_READY_EVENTS = 64;
+
+SocketDataSource::SocketDataSource(const QString &socketPath) : socketPath_(socketPath) {}
+
+SocketDataSource::~SocketDataSource()
+{
+  stop();
+}
+
+bool SocketDataSource::start()
+{
+  if (running_) {
+    return true;
+  }
+  // Cleans up after a socket thread that stopped on its own
+  stop();
+
+  const std::string path = socketPath_.toStdString();
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    error_ = "Invalid socket path";
+    return false;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  // Remove a socket left behind by an earlier run, but never anything else
+  struct stat status;
+  if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+    unlink(path.c_str());
+  }
+
+  listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    return fail("socket");
+  }
+  if (bind(listenFd_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+    return fail("bind");
+  }
+  if (listen(listenFd_, SOMAXCONN) < 0) {
+    return fail("listen");
+  }
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd_ < 0) {
+    return fail("epoll_create1");
+  }
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd_ < 0) {
+    return fail("eventfd");
+  }
+
+  for (const int fd : {listenFd_, wakeFd_}) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      return fail("epoll_ctl");
+    }
+  }
+
+  events_.clear();
+  latestSendTimeNs_ = 0;
+  latestEventMs_ = 0.0;
+  startTimeNs_ = IngestClockNs();
+  serveThread_ = std::thread(&SocketDataSource::serve, this);
+  running_ = true;
+
+  qDebug() << "Listening for allocation events on" << socketPath_;
+  return true;
+}
+
+void SocketDataSource::stop()
+{
+  // The thread is still joinable after it stopped on its own
+  if (!serveThread_.joinable()) {
+    return;
+  }
+
+  const uint64_t wake = 1;
+  if (running_ && write(wakeFd_, &wake, sizeof(wake)) < 0) {
+    qWarning() << "Failed to wake socket thread:" << strerror(errno);
+  }
+  serveThread_.join();
+
+  for (const auto &[fd, connection] : connections_) {
+    close(fd);
+  }
+  connections_.clear();
+  numConnections_ = 0;
+
+  closeSockets();
+  unlink(socketPath_.toStdString().c_str());
+  running_ = false;
+}
+
+double SocketDataSource::getElapsedTimeMs() const
+{
+  return double(IngestClockNs() - startTimeNs_) / 1e6;
+}
+
+void SocketDataSource::getRecentEvents(double maxAgeMs, AllocationEvents &recent) const
+{
+  events_.getRecentEvents(getElapsedTimeMs() - maxAgeMs, recent);
+}
+
+bool SocketDataSource::takeLatestBatch(uint64_t &sendTimeNs, double &lastEventMs)
+{
+  std::lock_guard lock(latestBatchMutex_);
+  if (latestSendTimeNs_ == 0) {
+    return false;
+  }
+
+  sendTimeNs = std::exchange(latestSendTimeNs_, 0);
+  lastEventMs = latestEventMs_;
+  return true;
+}
+
+bool SocketDataSource::fail(const char *what)
+{
+  error_ = QString("%1 failed on %2: %3").arg(what).arg(socketPath_).arg(strerror(errno));
+  closeSockets();
+  return false;
+}
+
+void SocketDataSource::closeSockets()
+{
+  for (int *fd : {&listenFd_, &epollFd_, &wakeFd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+void SocketDataSource::serve()
+{
+  epoll_event ready[MAX_READY_EVENTS];
+
+  for (;;) {
+    const int numReady = epoll_wait(epollFd_, ready, MAX_READY_EVENTS, -1);
+    if (numReady < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // Published by clearing running_, which the GUI thread checks first
+      error_ = QString("epoll_wait failed on %1: %2").arg(socketPath_).arg(strerror(errno));
+      qWarning() << error_;
+      flush();
+      running_ = false;
+      return;
+    }
+
+    for (int i = 0; i < numReady; ++i) {
+      const int fd = ready[i].data.fd;
+      if (fd == wakeFd_) {
+        flush();
+        return;
+      }
+
+      if (fd == listenFd_) {
+        acceptConnections();
+        continue;
+      }
+
+      auto connection = connections_.find(fd);
+      if (connection != connections_.end() && !readConnection(fd, connection->second)) {
+        closeConnection(fd);
+      }
+    }
+
+    // Everything read in one wakeup is handed over together
+    flush();
+  }
+}
+
+void SocketDataSource::acceptConnections()
+{
+  for (;;) {
+    const int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        qWarning() << "accept failed:" << strerror(errno);
+      }
+      return;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+
+    connections_[fd].buffer.resize(INITIAL_BUFFER_SIZE);
+    ++numConnections_;
+  }
+}
+
+void SocketDataSource::closeConnection(int fd)
+{
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connections_.erase(fd);
+  --numConnections_;
+}
+
+bool SocketDataSource::readConnection(int fd, Connection &connection)
+{
+  // One read per wakeup keeps a busy producer from starving the others
+  const ssize_t bytesRead = read(
+      fd, connection.buffer.data() + connection.used, connection.buffer.size() - connection.used);
+  if (bytesRead == 0) {
+    return false;
+  }
+  if (bytesRead < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+  connection.used += size_t(bytesRead);
+
+  const char *p = connection.buffer.data();
+  const char *end = p + connection.used;
+  size_t pendingBatchSize = 0;
+  uint64_t sendTimeNs = 0;
+  double lastEventMs = 0.0;
+  while (size_t(end - p) >= sizeof(IngestBatchHeader)) {
+    IngestBatchHeader header;
+    std::memcpy(&header, p, sizeof(header));
+    if (header.magic != INGEST_BATCH_MAGIC || header.count > INGEST_MAX_BATCH_EVENTS) {
+      qWarning() << "Closing connection with malformed batch";
+      return false;
+    }
+
+    const size_t batchSize = sizeof(IngestBatchHeader) + header.count * sizeof(IngestEvent);
+    if (size_t(end - p) < batchSize) {
+      pendingBatchSize = batchSize;
+      break;
+    }
+
+    // Signed so that events from before start() clamp to zero
+    const int64_t baseNs = int64_t(header.baseTimeNs - startTimeNs_);
+    const char *eventData = p + sizeof(IngestBatchHeader);
+    double batchEndMs = 0.0;
+    for (uint32_t i = 0; i < header.count; ++i) {
+      IngestEvent event;
+      std::memcpy(&event, eventData + i * sizeof(IngestEvent), sizeof(event));
+      const double timeMs = std::max(double(baseNs + int64_t(event.timeOffsetNs)) / 1e6, 0.0);
+      batch_.push_back(AllocationEvent{timeMs, size_t(event.size)});
+      batchEndMs = std::max(batchEndMs, timeMs);
+    }
+
+    sendTimeNs = header.sendTimeNs;
+    lastEventMs = batchEndMs;
+    p += batchSize;
+  }
+
+  if (sendTimeNs != 0) {
+    std::lock_guard lock(latestBatchMutex_);
+    latestSendTimeNs_ = sendTimeNs;
+    latestEventMs_ = lastEventMs;
+  }
+
+  connection.used = size_t(end - p);
+  std::memmove(connection.buffer.data(), p, connection.used);
+  if (pendingBatchSize > connection.buffer.size()) {
+    connection.buffer.resize(pendingBatchSize);
+  }
+  return true;
+}
+
+void SocketDataSource::flush()
+{
+  if (batch_.empty()) {
+    return;
+  }
+
+  if (TraceRecorder *recorder = recorder_.load(std::memory_order_acquire)) {
+    recorder->append(batch_.data(), batch_.size());
+  }
+
+  if (histogram_) {
+    for (const AllocationEvent &event : batch_) {
+      histogram_->record(event.timeMs, event.size);
+    }
+  }
+  else {
+    events_.append(batch_);
+  }
+  batch_.clear();
+}
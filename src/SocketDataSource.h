@@ -0,0 +1,99 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+#include "LiveEventBuffer.h"
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Listens on a Unix domain socket for event batches in the format described by
+// IngestProtocol.h. Any number of producers may be connected at once; a single
+// epoll thread reads from all of them. Linux only.
+class SocketDataSource : public LiveDataSource {
+ public:
+  explicit SocketDataSource(const QString &socketPath);
+  ~SocketDataSource() final;
+
+  bool start() final;
+  void stop() final;
+  bool isRunning() const final
+  {
+    return running_;
+  }
+
+  double getElapsedTimeMs() const final;
+
+  void getRecentEvents(double maxAgeMs, AllocationEvents &recent) const final;
+
+  // Producers batch events before sending them and are expected to send at
+  // least this often
+  double lateEventsMs() const final
+  {
+    return 100.0;
+  }
+
+  const QString &socketPath() const
+  {
+    return socketPath_;
+  }
+
+  // Reason the last start() failed, or why the source stopped running.
+  const QString &errorString() const
+  {
+    return error_;
+  }
+
+  int numConnections() const
+  {
+    return numConnections_;
+  }
+
+  // The newest batch received since the last call: its send time and the
+  // capture time of its last event. Returns false if none arrived.
+  bool takeLatestBatch(uint64_t &sendTimeNs, double &lastEventMs);
+
+ private:
+  struct Connection {
+    std::vector<char> buffer;
+    size_t used = 0;
+  };
+
+  void serve();
+  void acceptConnections();
+  bool readConnection(int fd, Connection &connection);
+  void closeConnection(int fd);
+  void flush();
+  bool fail(const char *what);
+  void closeSockets();
+
+  QString socketPath_;
+  QString error_;
+  uint64_t startTimeNs_ = 0;
+  int listenFd_ = -1;
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  std::thread serveThread_;
+  // Cleared by the socket thread if it fails
+  std::atomic<bool> running_ = false;
+
+  // Only touched by the serve thread
+  std::unordered_map<int, Connection> connections_;
+  AllocationEvents batch_;
+
+  std::atomic<int> numConnections_ = 0;
+
+  std::mutex latestBatchMutex_;
+  uint64_t latestSendTimeNs_ = 0;
+  double latestEventMs_ = 0.0;
+
+  mutable LiveEventBuffer events_;
+};
@@ -0,0 +1,205 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "TraceLoader.h"
+#include "CSVDataSource.h"
+#include "MergedCSVDataSource.h"
+
+#include <QFileInfo>
+
+TraceLoader::TraceLoader(const QStringList &filePaths)
+{
+  for (const QString &filePath : filePaths) {
+    const QFileInfo info(filePath);
+    filePaths_.push_back(info.filesystemFilePath());
+    totalBytes_ += info.size();
+  }
+}
+
+TraceLoader::~TraceLoader()
+{
+  cancel();
+}
+
+void TraceLoader::start()
+{
+  if (thread_.joinable()) {
+    return;
+  }
+
+  thread_ = std::thread(&TraceLoader::run, this);
+}
+
+void TraceLoader::cancel()
+{
+  if (!finished_) {
+    canceled_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void TraceLoader::takeEvents(AllocationEvents &events, AllocationSources &sources)
+{
+  events.clear();
+  sources.clear();
+
+  std::lock_guard lock(mutex_);
+  std::swap(events, pendingEvents_);
+  std::swap(sources, pendingSources_);
+}
+
+void TraceLoader::run()
+{
+  if (isMerged()) {
+    MergedCSVDataSource(filePaths_).readChunks(
+        CSVDataSource::ChunkSize,
+        [this](const AllocationEvents &events, const AllocationSources &sources) {
+          std::lock_guard lock(mutex_);
+          pendingEvents_.insert(pendingEvents_.end(), events.begin(), events.end());
+          pendingSources_.insert(pendingSources_.end(), sources.begin(), sources.end());
+          return !canceled_;
+        },
+        &bytesRead_);
+  }
+  else {
+    CSVDataSource(filePaths_.front()).readChunks(
+        CSVDataSource::ChunkSize,
+        [this](const AllocationEvents &events) {
+          std::lock_guard lock(mutex_);
+          pendingEvents_.insert(pendingEvents_.end(), events.begin(), events.end());
+          return !canceled_;
+        },
+        &bytesRead_);
+  }
+
+  finished_ = true;
+}
+
+CompareLoader::CompareLoader(const QString &baselinePath,
+                             const QString &candidatePath,
+                             double maxTimeRangeMs,
+                             int numColumns)
+    : maxTimeRangeMs_(maxTimeRangeMs), numColumns_(numColumns)
+{
+  const QFileInfo baselineInfo(baselinePath);
+  const QFileInfo candidateInfo(candidatePath);
+  baselinePath_ = baselineInfo.filesystemFilePath();
+  candidatePath_ = candidateInfo.filesystemFilePath();
+  totalBytes_ = baselineInfo.size() + candidateInfo.size();
+}
+
+CompareLoader::~CompareLoader()
+{
+  cancel();
+}
+
+void CompareLoader::start()
+{
+  if (thread_.joinable()) {
+    return;
+  }
+
+  thread_ = std::thread(&CompareLoader::run, this);
+}
+
+void CompareLoader::cancel()
+{
+  if (!finished_) {
+    canceled_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+TraceComparison CompareLoader::takeComparison()
+{
+  return std::move(comparison_);
+}
+
+void CompareLoader::run()
+{
+  auto load = [this](const std::filesystem::path &filePath) {
+    AllocationEvents events;
+    CSVDataSource(filePath).readChunks(
+        CSVDataSource::ChunkSize,
+        [&](const AllocationEvents &chunk) {
+          events.insert(events.end(), chunk.begin(), chunk.end());
+          return !canceled_;
+        },
+        &bytesRead_);
+    return events;
+  };
+
+  AllocationEvents baseline;
+  std::thread baselineLoader([&]() { baseline = load(baselinePath_); });
+  AllocationEvents candidate = load(candidatePath_);
+  baselineLoader.join();
+
+  if (!canceled_ && !baseline.empty() && !candidate.empty()) {
+    comparison_ = CompareTraces(std::move(baseline),
+                                std::move(candidate),
+                                maxTimeRangeMs_,
+                                numColumns_,
+                                std::thread::hardware_concurrency());
+  }
+
+  finished_ = true;
+}
+
+SizeClassLoader::SizeClassLoader(const SizeDistributionQuery &query,
+                                 const SizeClassOptions &options,
+                                 std::vector<size_t> currentLimits,
+                                 std::function<void()> onFinished)
+    : query_(query),
+      options_(options),
+      currentLimits_(std::move(currentLimits)),
+      onFinished_(std::move(onFinished))
+{
+}
+
+SizeClassLoader::~SizeClassLoader()
+{
+  cancel();
+}
+
+void SizeClassLoader::start()
+{
+  if (thread_.joinable()) {
+    return;
+  }
+
+  thread_ = std::thread(&SizeClassLoader::run, this);
+}
+
+void SizeClassLoader::cancel()
+{
+  if (!finished_) {
+    canceled_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+SizeClassResult SizeClassLoader::takeResult()
+{
+  return std::move(result_);
+}
+
+void SizeClassLoader::run()
+{
+  const SizeDistribution distribution = BuildSizeDistribution(
+      query_, std::thread::hardware_concurrency(), canceled_, eventsRead_);
+
+  if (!canceled_) {
+    result_.recommendation = RecommendSizeClasses(distribution, options_);
+    result_.totalCount = distribution.totalCount();
+    result_.currentWastedBytes = WastedBytes(distribution, currentLimits_);
+  }
+
+  finished_ = true;
+  onFinished_();
+}
@@ -0,0 +1,182 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+#include "Histogram.h"
+#include "SizeClasses.h"
+
+#include <QStringList>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Parses one or more CSV traces on a background thread. Parsed events are
+// collected until the GUI thread takes them, so the waterfall can fill in
+// while the rest of the file is still being read. Several files are merged
+// into one time-ordered stream with per-event source indices.
+class TraceLoader {
+ public:
+  explicit TraceLoader(const QStringList &filePaths);
+  ~TraceLoader();
+
+  void start();
+  void cancel();
+
+  bool isMerged() const
+  {
+    return filePaths_.size() > 1;
+  }
+  bool isFinished() const
+  {
+    return finished_;
+  }
+  bool wasCanceled() const
+  {
+    return canceled_;
+  }
+
+  int64_t bytesRead() const
+  {
+    return bytesRead_;
+  }
+  int64_t totalBytes() const
+  {
+    return totalBytes_;
+  }
+
+  // Moves all events parsed since the last call into `events` and `sources`.
+  // `sources` stays empty when a single file is loaded.
+  void takeEvents(AllocationEvents &events, AllocationSources &sources);
+
+ private:
+  void run();
+
+  std::vector<std::filesystem::path> filePaths_;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  AllocationEvents pendingEvents_;
+  AllocationSources pendingSources_;
+
+  std::atomic<int64_t> bytesRead_ = 0;
+  int64_t totalBytes_ = 0;
+  std::atomic<bool> canceled_ = false;
+  std::atomic<bool> finished_ = false;
+};
+
+// Parses a baseline and a candidate trace on background threads and prepares
+// their comparison there too, so the GUI thread only has to display it.
+class CompareLoader {
+ public:
+  CompareLoader(const QString &baselinePath,
+                const QString &candidatePath,
+                double maxTimeRangeMs,
+                int numColumns);
+  ~CompareLoader();
+
+  void start();
+  void cancel();
+
+  bool isFinished() const
+  {
+    return finished_;
+  }
+  bool wasCanceled() const
+  {
+    return canceled_;
+  }
+
+  int64_t bytesRead() const
+  {
+    return bytesRead_;
+  }
+  int64_t totalBytes() const
+  {
+    return totalBytes_;
+  }
+
+  // The prepared comparison once finished. Both traces are empty when either
+  // failed to load or loading was canceled.
+  TraceComparison takeComparison();
+
+ private:
+  void run();
+
+  std::filesystem::path baselinePath_;
+  std::filesystem::path candidatePath_;
+  double maxTimeRangeMs_;
+  int numColumns_;
+  std::thread thread_;
+  TraceComparison comparison_;
+
+  std::atomic<int64_t> bytesRead_ = 0;
+  int64_t totalBytes_ = 0;
+  std::atomic<bool> canceled_ = false;
+  std::atomic<bool> finished_ = false;
+};
+
+struct SizeClassResult {
+  SizeClassRecommendation recommendation;
+  uint64_t totalCount = 0;
+  // Waste of the size buckets that were current when the loader was created
+  uint64_t currentWastedBytes = 0;
+};
+
+// Builds the size distribution of the queried events and recommends size
+// classes for it on a background thread. The queried events must not change
+// until the loader is finished or canceled. `onFinished` is called on that
+// thread once it is done, canceled or not.
+class SizeClassLoader {
+ public:
+  SizeClassLoader(const SizeDistributionQuery &query,
+                  const SizeClassOptions &options,
+                  std::vector<size_t> currentLimits,
+                  std::function<void()> onFinished);
+  ~SizeClassLoader();
+
+  void start();
+  void cancel();
+
+  bool isFinished() const
+  {
+    return finished_;
+  }
+  bool wasCanceled() const
+  {
+    return canceled_;
+  }
+
+  int64_t eventsRead() const
+  {
+    return eventsRead_;
+  }
+  int64_t totalEvents() const
+  {
+    return int64_t(query_.events->size());
+  }
+
+  // The recommendation once finished. It has no plans when there were no
+  // events or loading was canceled.
+  SizeClassResult takeResult();
+
+ private:
+  void run();
+
+  SizeDistributionQuery query_;
+  SizeClassOptions options_;
+  std::vector<size_t> currentLimits_;
+  std::function<void()> onFinished_;
+  std::thread thread_;
+  SizeClassResult result_;
+
+  std::atomic<int64_t> eventsRead_ = 0;
+  std::atomic<bool> canceled_ = false;
+  std::atomic<bool> finished_ = false;
+};
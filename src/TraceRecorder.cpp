@@ -0,0 +1,194 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "TraceRecorder.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <system_error>
+
+// Size of each write to the file
+constexpr size_t TEXT_BLOCK_SIZE = 4 * 1024 * 1024;
+// Longest line FormatLine() can produce
+constexpr size_t MAX_LINE_SIZE = 64;
+// Unwritten events are swapped out at least this often, so little is lost
+// if the viewer goes away without closing the recording.
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(500);
+
+// Formats "time, size\n" the same way the CSV examples are written. Times too
+// large for fixed notation fall back to the shortest form, which the parser
+// reads as well.
+static char *FormatLine(char *p, const AllocationEvent &event)
+{
+  auto [timeEnd, timeError] = std::to_chars(p, p + 32, event.timeMs, std::chars_format::fixed, 6);
+  if (timeError != std::errc()) {
+    timeEnd = std::to_chars(p, p + 32, event.timeMs).ptr;
+  }
+  p = timeEnd;
+  *p++ = ',';
+  *p++ = ' ';
+  // Always fits, see the static_assert
+  p = std::to_chars(p, p + 24, static_cast<unsigned long long>(event.size)).ptr;
+  *p++ = '\n';
+  return p;
+}
+static_assert(std::numeric_limits<unsigned long long>::digits10 + 1 <= 24);
+
+TraceRecorder::TraceRecorder(const std::filesystem::path &filePath) : filePath_(filePath) {}
+
+TraceRecorder::~TraceRecorder()
+{
+  close();
+}
+
+bool TraceRecorder::open()
+{
+  if (open_) {
+    return true;
+  }
+
+  // Writes are already made in large blocks, so skip the stream's own buffer
+  file_.rdbuf()->pubsetbuf(nullptr, 0);
+  file_.open(filePath_, std::ios::binary | std::ios::trunc);
+  if (!file_) {
+    std::fprintf(stderr, "Failed to open file for recording: %s\n", filePath_.string().c_str());
+    return false;
+  }
+
+  text_.resize(TEXT_BLOCK_SIZE + MAX_LINE_SIZE);
+  swapDue_ = false;
+  stopping_ = false;
+  open_ = true;
+  writerThread_ = std::thread(&TraceRecorder::run, this);
+  return true;
+}
+
+void TraceRecorder::close()
+{
+  if (!open_.exchange(false)) {
+    return;
+  }
+
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+
+  if (writerThread_.joinable()) {
+    writerThread_.join();
+  }
+  file_.close();
+}
+
+void TraceRecorder::append(const AllocationEvent *events, size_t count)
+{
+  Shard &shard = shards_[ThreadShardIndex() % NumShards];
+  bool swapDue = false;
+  {
+    std::lock_guard lock(shard.mutex);
+    if (!open_) {
+      return;
+    }
+    const size_t before = shard.events.size();
+    shard.events.insert(shard.events.end(), events, events + count);
+    swapDue = before < SwapEvents && shard.events.size() >= SwapEvents;
+  }
+
+  // Wake the writer only once per full buffer
+  if (swapDue) {
+    {
+      std::lock_guard lock(mutex_);
+      swapDue_ = true;
+    }
+    wake_.notify_one();
+  }
+}
+
+void TraceRecorder::run()
+{
+  for (;;) {
+    bool stopping;
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait_for(lock, FLUSH_INTERVAL, [this]() { return stopping_ || swapDue_; });
+      stopping = stopping_;
+      swapDue_ = false;
+    }
+
+    // Appends that come after this swap see the recorder closed once stopping,
+    // so nothing is left behind in the shards.
+    for (int i = 0; i < NumShards; ++i) {
+      std::lock_guard lock(shards_[i].mutex);
+      std::swap(shards_[i].events, back_[i]);
+    }
+
+    writeEvents();
+    if (stopping) {
+      break;
+    }
+  }
+}
+
+void TraceRecorder::writeEvents()
+{
+  if (failed_) {
+    for (AllocationEvents &events : back_) {
+      events.clear();
+    }
+    return;
+  }
+
+  // Each shard holds the events of its threads in the order they were
+  // appended, so merging the shards by time keeps the file in about the order
+  // the events happened, like a single buffer did.
+  std::array<size_t, NumShards> next{};
+  char *p = text_.data();
+  size_t numLines = 0;
+  for (;;) {
+    int shard = -1;
+    for (int i = 0; i < NumShards; ++i) {
+      if (next[i] < back_[i].size() &&
+          (shard < 0 || back_[i][next[i]].timeMs < back_[shard][next[shard]].timeMs))
+      {
+        shard = i;
+      }
+    }
+    if (shard < 0) {
+      break;
+    }
+
+    p = FormatLine(p, back_[shard][next[shard]++]);
+    ++numLines;
+    if (size_t(p - text_.data()) >= TEXT_BLOCK_SIZE) {
+      writeText(size_t(p - text_.data()), numLines);
+      p = text_.data();
+      numLines = 0;
+    }
+  }
+  writeText(size_t(p - text_.data()), numLines);
+
+  for (AllocationEvents &events : back_) {
+    events.clear();
+  }
+}
+
+void TraceRecorder::writeText(size_t size, size_t numEvents)
+{
+  if (size == 0 || failed_) {
+    return;
+  }
+
+  if (!file_.write(text_.data(), std::streamsize(size))) {
+    std::fprintf(stderr,
+                 "Failed to write recording after %zu events: %s\n",
+                 size_t(eventsWritten_),
+                 filePath_.string().c_str());
+    failed_ = true;
+    return;
+  }
+  bytesWritten_ += int64_t(size);
+  eventsWritten_ += numEvents;
+}
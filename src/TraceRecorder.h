@@ -0,0 +1,88 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include "DataSource.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Writes live events to a CSV trace that can be opened again later. Capture
+// threads only append to in-memory buffers, one of several shards each so that
+// they do not wait on one another. A writer thread swaps every shard with a
+// second set of buffers once enough events have built up in one, or
+// periodically, then merges them by time, formats them and writes them in
+// large sequential blocks while capture continues into the first set.
+class TraceRecorder {
+ public:
+  // Events in one shard that trigger a buffer swap; a slow disk lets the
+  // buffers grow instead of holding up the capture.
+  static constexpr size_t SwapEvents = 256 * 1024;
+  static constexpr int NumShards = 8;
+
+  explicit TraceRecorder(const std::filesystem::path &filePath);
+  ~TraceRecorder();
+
+  bool open();
+  // Writes everything appended so far and closes the file.
+  void close();
+
+  // Safe to call from any thread. Ignored unless open.
+  void append(const AllocationEvent *events, size_t count);
+
+  const std::filesystem::path &filePath() const
+  {
+    return filePath_;
+  }
+  // Events that made it to the file. Stops counting once a write fails.
+  size_t eventsWritten() const
+  {
+    return eventsWritten_;
+  }
+  int64_t bytesWritten() const
+  {
+    return bytesWritten_;
+  }
+  bool failed() const
+  {
+    return failed_;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    AllocationEvents events;
+  };
+
+  void run();
+  void writeEvents();
+  void writeText(size_t size, size_t numEvents);
+
+  std::filesystem::path filePath_;
+  std::ofstream file_;
+  std::thread writerThread_;
+
+  std::array<Shard, NumShards> shards_;
+  std::atomic<bool> open_ = false;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool swapDue_ = false;
+  bool stopping_ = false;
+
+  // Only touched by the writer thread
+  std::array<AllocationEvents, NumShards> back_;
+  std::vector<char> text_;
+
+  std::atomic<size_t> eventsWritten_ = 0;
+  std::atomic<int64_t> bytesWritten_ = 0;
+  std::atomic<bool> failed_ = false;
+};
@@ -2,12 +2,14 @@
  *
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #include "WaterfallWidget.h"
+#include "ColorMap.h"
+#include "SizeBuckets.h"
 
 #include <QPainter>
 
 #include <algorithm>
-#include <array>
-#include <numeric>
+#include <cmath>
+#include <thread>
 #include <vector>
 
 struct pair_hash {
@@ -27,68 +29,326 @@ struct pair_equal {
   }
 };
 
-constexpr double MAX_TIME_WINDOW_MS = 30000.0;
+WaterfallWidget::WaterfallWidget(QWidget *parent) : QWidget(parent)
+{
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
 
-// Viridis colormap
-constexpr int NUM_COLORS = 400;
-constexpr std::array<QColor, NUM_COLORS + 1> COLOR_MAP = []() {
-  std::array<QColor, NUM_COLORS + 1> map;
-  for (int i = 0; i <= NUM_COLORS; ++i) {
-    const double t = i / double(NUM_COLORS);
+void WaterfallWidget::setData(const AllocationEvents &events)
+{
+  events_ = events;
+  sources_ = AllocationSources();
+  sourceFilter_ = -1;
+  liveMode_ = false;
+  liveAggregated_ = false;
+  compareMode_ = false;
+  comparison_ = TraceComparison();
+  progressiveLoading_ = false;
+  currentTimeMs_ = 0.0;
+  histogramDirty_ = true;
+  updateVisualization();
+}
 
-    double r = 0;
-    double g = 0;
-    double b = 0;
+void WaterfallWidget::beginProgressiveData()
+{
+  events_ = AllocationEvents();
+  sources_ = AllocationSources();
+  sourceFilter_ = -1;
+  liveMode_ = false;
+  liveAggregated_ = false;
+  compareMode_ = false;
+  comparison_ = TraceComparison();
+  currentTimeMs_ = 0.0;
+  progressiveLoading_ = true;
+  progressiveStartMs_ = 0.0;
+
+  data_.prepare(accumulationColumns_, sizeBuckets_.size());
+  dataGrid_ = TimeGrid{0.0, MAX_TIME_WINDOW_MS / accumulationColumns_, accumulationColumns_};
+  stats_ = AllocationStats{};
+  stats_.timeBucketMs = MAX_TIME_WINDOW_MS / accumulationColumns_;
+  resetBurstDetector(0.0, stats_.timeBucketMs);
+  histogramDirty_ = false;
+  updateVisualization();
+}
 
-    if (t < 0.5) {
-      r = 0.267004 + 2 * t * (0.127568 - 0.267004);
-      g = 0.004874 + 2 * t * (0.566949 - 0.004874);
-      b = 0.329415 + 2 * t * (0.550556 - 0.329415);
-    }
-    else {
-      const double t2 = 2 * (t - 0.5);
-      r = 0.127568 + t2 * (0.993248 - 0.127568);
-      g = 0.566949 + t2 * (0.906157 - 0.566949);
-      b = 0.550556 + t2 * (0.143936 - 0.550556);
+void WaterfallWidget::appendData(const AllocationEvents &events, const AllocationSources &sources)
+{
+  if (!progressiveLoading_ || events.empty()) {
+    return;
+  }
+
+  if (events_.empty()) {
+    progressiveStartMs_ = std::min_element(events.begin(),
+                                           events.end(),
+                                           [](const AllocationEvent &a, const AllocationEvent &b) {
+                                             return a.timeMs < b.timeMs;
+                                           })
+                              ->timeMs;
+  }
+
+  const size_t first = events_.size();
+  events_.insert(events_.end(), events.begin(), events.end());
+  sources_.insert(sources_.end(), sources.begin(), sources.end());
+
+  // Only the new chunk needs binning, unless a full re-bin is already pending
+  if (!histogramDirty_) {
+    const double timeBucketMs = MAX_TIME_WINDOW_MS / accumulationColumns_;
+    dataGrid_ = TimeGrid{progressiveStartMs_, timeBucketMs, accumulationColumns_};
+    binEvents(first, dataGrid_);
+  }
+
+  updateVisualization();
+}
+
+void WaterfallWidget::endProgressiveData()
+{
+  if (!progressiveLoading_) {
+    return;
+  }
+
+  progressiveLoading_ = false;
+
+  // Re-bin once with the real time range if it differs from the assumed one,
+  // i.e. the trace is shorter than a full window or was not sorted by time.
+  if (!events_.empty()) {
+    auto [minEvent, maxEvent] = std::minmax_element(
+        events_.begin(), events_.end(), [](const AllocationEvent &a, const AllocationEvent &b) {
+          return a.timeMs < b.timeMs;
+        });
+    if (minEvent->timeMs < progressiveStartMs_ ||
+        maxEvent->timeMs - minEvent->timeMs < MAX_TIME_WINDOW_MS)
+    {
+      histogramDirty_ = true;
     }
+  }
 
-    map[i] = QColor(int(r * 255), int(g * 255), int(b * 255));
+  // A re-bin runs detection itself, otherwise the progressive grid is final
+  if (!histogramDirty_) {
+    resetBurstDetector(dataGrid_.startMs, dataGrid_.bucketMs);
+    detectBursts(0, 0, dataGrid_.numBuckets);
   }
-  return map;
-}();
 
-constexpr std::array<size_t, 36> SIZE_BUCKETS = {
-    8,     16,    32,    48,    64,    80,    96,    112,    128,    160,    192,     224,
-    256,   320,   384,   448,   512,   640,   768,   896,    1024,   2048,   4096,    8192,
-    16384, 24576, 32768, 49152, 65536, 81920, 98304, 114688, 131072, 524288, 2097152, ULLONG_MAX};
+  updateVisualization();
+}
 
-constexpr int GetSizeBucketIndex(size_t size)
+void WaterfallWidget::setSourceFilter(int source)
 {
-  const auto index = std::lower_bound(SIZE_BUCKETS.begin(), SIZE_BUCKETS.end(), size);
-  return int(std::distance(SIZE_BUCKETS.begin(), index));
+  if (source == sourceFilter_) {
+    return;
+  }
+
+  sourceFilter_ = source;
+  histogramDirty_ = true;
+  updateVisualization();
 }
 
-WaterfallWidget::WaterfallWidget(QWidget *parent) : QWidget(parent)
+void WaterfallWidget::setSizeBuckets(const SizeBucketScheme &sizeBuckets)
 {
-  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+  if (sizeBuckets == sizeBuckets_) {
+    return;
+  }
+
+  sizeBuckets_ = sizeBuckets;
+  if (liveMode_ && !liveAggregated_) {
+    resetBurstDetector(0.0, burstDetector_.columnMs());
+  }
+  histogramDirty_ = true;
+  updateVisualization();
 }
 
-void WaterfallWidget::setData(const AllocationEvents &events)
+SizeDistributionQuery WaterfallWidget::sizeDistributionQuery() const
 {
-  events_ = events;
+  SizeDistributionQuery query;
+  if (compareMode_) {
+    query.events = &comparison_.candidate;
+    query.startMs = comparison_.candidateStartMs;
+    query.endMs = comparison_.candidateStartMs + comparison_.timeRangeMs;
+    return query;
+  }
+
+  query.events = &events_;
+  query.startMs = dataGrid_.startMs;
+  query.endMs = dataGrid_.endMs();
+  if (sourceFilter_ >= 0 && !sources_.empty()) {
+    query.sources = &sources_;
+    query.source = sourceFilter_;
+  }
+  return query;
+}
+
+void WaterfallWidget::setCompareData(TraceComparison comparison)
+{
+  events_ = AllocationEvents();
+  comparison_ = std::move(comparison);
+  sources_ = AllocationSources();
+  sourceFilter_ = -1;
   liveMode_ = false;
+  liveAggregated_ = false;
+  compareMode_ = true;
+  progressiveLoading_ = false;
   currentTimeMs_ = 0.0;
+  histogramDirty_ = true;
+  updateVisualization();
+}
+
+void WaterfallWidget::setAccumulationColumns(int numColumns)
+{
+  numColumns = std::max(1, numColumns);
+  if (numColumns == accumulationColumns_) {
+    return;
+  }
+
+  accumulationColumns_ = numColumns;
+  histogramDirty_ = true;
   updateVisualization();
 }
 
-void WaterfallWidget::setLiveMode(bool enabled)
+void WaterfallWidget::setLiveMode(bool enabled, double lateEventsMs)
 {
   liveMode_ = enabled;
+  liveLateEventsMs_ = lateEventsMs;
+  liveAggregated_ = false;
+  if (enabled) {
+    compareMode_ = false;
+    progressiveLoading_ = false;
+    comparison_ = TraceComparison();
+    sources_ = AllocationSources();
+    sourceFilter_ = -1;
+    liveColumns_ = std::vector<uint32_t>();
+    liveNewestColumn_ = -1;
+    resetBurstDetector(0.0, MAX_TIME_WINDOW_MS / accumulationColumns_);
+  }
   if (!enabled) {
     currentTimeMs_ = 0.0;
   }
 }
 
+void WaterfallWidget::updateLiveHistogram(LiveHistogram &histogram, double timeMs)
+{
+  currentTimeMs_ = timeMs;
+  if (!liveMode_) {
+    return;
+  }
+
+  const int numColumns = histogram.numColumns();
+  const int numSizeBuckets = LiveHistogram::NumSizeBuckets;
+  if (!liveAggregated_ || liveColumns_.size() != size_t(numColumns) * numSizeBuckets) {
+    liveColumns_.assign(size_t(numColumns) * numSizeBuckets, 0);
+    liveNewestColumn_ = -1;
+    liveAggregated_ = true;
+    resetBurstDetector(0.0, histogram.columnMs());
+  }
+
+  auto columnSlot = [&](int64_t column) {
+    return liveColumns_.begin() + ptrdiff_t(column % numColumns) * numSizeBuckets;
+  };
+
+  histogram.drainFinishedColumns(
+      timeMs, [&](int64_t column, const LiveHistogram::ColumnCounts &counts) {
+        // Columns skipped since the last drain had no events
+        const int64_t firstSkipped = std::max(liveNewestColumn_ + 1, column - numColumns + 1);
+        for (int64_t skipped = firstSkipped; skipped < column; ++skipped) {
+          std::fill_n(columnSlot(skipped), numSizeBuckets, 0);
+        }
+        std::copy(counts.begin(), counts.end(), columnSlot(column));
+        liveNewestColumn_ = column;
+        burstDetector_.addColumn(column, counts.data());
+      });
+
+  // The window ends at the newest column that could have been drained, so the
+  // waterfall keeps scrolling when no events arrive.
+  const int64_t endColumn = histogram.finishedColumnEnd(timeMs);
+  const int64_t firstColumn = endColumn - numColumns;
+
+  const double columnMs = histogram.columnMs();
+  data_.prepare(numColumns, numSizeBuckets);
+  dataGrid_ = TimeGrid{double(firstColumn) * columnMs, columnMs, numColumns};
+  for (int t = 0; t < numColumns; ++t) {
+    const int64_t column = firstColumn + t;
+    if (column < 0 || column > liveNewestColumn_ || column <= liveNewestColumn_ - numColumns) {
+      continue;
+    }
+    auto counts = columnSlot(column);
+    for (int s = 0; s < numSizeBuckets; ++s) {
+      if (counts[s] != 0) {
+        data_.addCount(t, s, counts[s]);
+      }
+    }
+  }
+
+  stats_ = histogram.stats();
+  stats_.maxTimeBucketAllocationCount = size_t(data_.maxCount());
+  histogramDirty_ = false;
+  updateVisualization();
+}
+
+void WaterfallWidget::setShowBursts(bool show)
+{
+  showBursts_ = show;
+  updateVisualization();
+}
+
+void WaterfallWidget::setBurstThreshold(double threshold)
+{
+  burstOptions_.threshold = threshold;
+  if (compareMode_ || progressiveLoading_) {
+    return;
+  }
+
+  // Traces are searched again with the new threshold, live captures only use
+  // it from here on
+  if (liveMode_) {
+    resetBurstDetector(0.0, burstDetector_.columnMs());
+  }
+  else {
+    resetBurstDetector(dataGrid_.startMs, dataGrid_.bucketMs);
+    detectBursts(0, 0, data_.numTimeBuckets());
+  }
+  updateVisualization();
+}
+
+void WaterfallWidget::resetBurstDetector(double originMs, double columnMs)
+{
+  burstDetector_ = BurstDetector(originMs, columnMs, burstOptions_, shownSizeBuckets().size());
+}
+
+void WaterfallWidget::detectBursts(int64_t firstColumn, int first, int last)
+{
+  std::vector<uint32_t> counts(data_.numSizeBuckets());
+  for (int t = first; t < last; ++t) {
+    std::fill(counts.begin(), counts.end(), 0);
+    data_.processColumn(t, [&](int s, int32_t count) {
+      counts[s] = uint32_t(std::max(count, 0));
+    });
+    burstDetector_.addColumn(firstColumn + t, counts.data());
+  }
+}
+
+void WaterfallWidget::drawBursts(QPainter &painter, int pixmapHeight, int bucketHeight) const
+{
+  const double rangeMs = dataGrid_.bucketMs * dataGrid_.numBuckets;
+  if (rangeMs <= 0.0) {
+    return;
+  }
+
+  const double pixelsPerMs = width() / rangeMs;
+  painter.setPen(QColor(255, 255, 255));
+  for (const Bookmark &bookmark : burstDetector_.bookmarks()) {
+    const double offsetMs = bookmark.timeMs - dataGrid_.startMs;
+    if (offsetMs + bookmark.durationMs < 0.0 || offsetMs > rangeMs) {
+      continue;
+    }
+
+    // Outline the burst cells and tick the top edge so bursts in quiet,
+    // dark areas still stand out
+    const int x = int(offsetMs * pixelsPerMs);
+    const int w = std::max(1, int(bookmark.durationMs * pixelsPerMs));
+    const int y = pixmapHeight - (bookmark.sizeBucket + 1) * bucketHeight;
+    painter.drawRect(x, y, w, bucketHeight - 1);
+    painter.fillRect(x, 0, std::max(w, 2), 4, QColor(255, 255, 255));
+  }
+}
+
 QSize WaterfallWidget::sizeHint() const
 {
   return QSize(800, 600);
@@ -96,20 +356,30 @@ QSize WaterfallWidget::sizeHint() const
 
 QColor WaterfallWidget::getColorForCount(int count) const
 {
-  if (count < 0)
-    count = 0;
-  if (count > NUM_COLORS)
-    count = NUM_COLORS;
-  return COLOR_MAP[count];
+  const ColorRgb color = GetColorForCount(count);
+  return QColor(color.r, color.g, color.b);
+}
+
+QColor WaterfallWidget::getColorForDelta(int delta) const
+{
+  const ColorRgb color = GetColorForDelta(delta);
+  return QColor(color.r, color.g, color.b);
 }
 
-void WaterfallWidget::processDataForCurrentSize()
+void WaterfallWidget::processData()
 {
-  if (width() <= 0) {
+  if (compareMode_) {
+    processCompareData();
+    return;
+  }
+
+  // Rebuilt by updateLiveHistogram() on the next update
+  if (liveAggregated_) {
     return;
   }
 
   if (events_.empty() && !liveMode_) {
+    resetBurstDetector(0.0, 1.0);
     return;
   }
 
@@ -118,11 +388,18 @@ void WaterfallWidget::processDataForCurrentSize()
   double startTime;
 
   if (liveMode_) {
+    // Aligned to whole time buckets so that a bucket keeps its events from one
+    // update to the next and can be handed to burst detection once finished
+    const double timeBucketMs = displayTimeRange / accumulationColumns_;
     endTime = currentTimeMs_;
-    startTime = endTime - displayTimeRange;
-    if (startTime < 0) {
-      startTime = 0;
-    }
+    startTime = std::floor(std::max(endTime - displayTimeRange, 0.0) / timeBucketMs) *
+                timeBucketMs;
+  }
+  else if (progressiveLoading_) {
+    // The full time range is unknown until loading finishes, so assume a full
+    // window starting at the first chunk. appendData() bins onto the same grid.
+    startTime = progressiveStartMs_;
+    endTime = startTime + displayTimeRange;
   }
   else {
     if (events_.empty()) {
@@ -143,38 +420,74 @@ void WaterfallWidget::processDataForCurrentSize()
     endTime = startTime + displayTimeRange;
   }
 
-  const double timeBucketMs = displayTimeRange / width();
+  const double timeBucketMs = displayTimeRange / accumulationColumns_;
 
-  data_.prepare(width(), SIZE_BUCKETS.size());
+  data_.prepare(accumulationColumns_, sizeBuckets_.size());
+  dataGrid_ = TimeGrid{startTime, timeBucketMs, accumulationColumns_};
+  stats_ = AllocationStats{};
+  stats_.timeBucketMs = timeBucketMs;
+  binEvents(0, dataGrid_);
 
-  for (const AllocationEvent &event : events_) {
-    if (event.timeMs < startTime || event.timeMs > endTime) {
-      continue;
+  if (liveMode_) {
+    if (burstDetector_.columnMs() != timeBucketMs) {
+      resetBurstDetector(0.0, timeBucketMs);
     }
-
-    int timeBucket = int((event.timeMs - startTime) / timeBucketMs);
-    if (timeBucket >= width()) {
-      timeBucket = width() - 1;
+    // Only buckets that late events can no longer reach are finished
+    const int64_t firstColumn = std::llround(startTime / timeBucketMs);
+    const int64_t finishedEnd = int64_t((currentTimeMs_ - liveLateEventsMs_) / timeBucketMs);
+    const int64_t first = std::max(burstDetector_.nextColumn(), firstColumn);
+    const int64_t last = std::min(finishedEnd, firstColumn + accumulationColumns_);
+    if (first < last) {
+      detectBursts(firstColumn, int(first - firstColumn), int(last - firstColumn));
     }
-    const int sizeBucket = GetSizeBucketIndex(event.size);
+  }
+  else if (!progressiveLoading_) {
+    resetBurstDetector(startTime, timeBucketMs);
+    detectBursts(0, 0, accumulationColumns_);
+  }
+}
 
-    data_.incrementCount(timeBucket, sizeBucket);
+void WaterfallWidget::binEvents(size_t first, const TimeGrid &grid)
+{
+  // The time grid covers every source so that the combined and per-source
+  // views share the same time axis.
+  const bool filtered = sourceFilter_ >= 0 && !sources_.empty();
+
+  if (filtered) {
+    BinEvents(events_.data() + first,
+              events_.data() + events_.size(),
+              sources_.data() + first,
+              uint16_t(sourceFilter_),
+              grid,
+              data_,
+              sizeBuckets_);
+  }
+  else {
+    BinEvents(events_.data() + first, events_.data() + events_.size(), grid, data_, sizeBuckets_);
   }
 
   // Allocation statistics
-  auto maxEvent = std::max_element(
-      events_.begin(), events_.end(), [](const AllocationEvent &a, const AllocationEvent &b) {
-        return a.size < b.size;
-      });
-  auto maxCount = std::max_element(data_.rawCounts_.begin(), data_.rawCounts_.end());
-  stats_.timeBucketMs = timeBucketMs;
-  stats_.totalAllocations = events_.size();
-  stats_.totalSize = std::accumulate(
-      events_.begin(), events_.end(), size_t(0), [](size_t sum, const AllocationEvent &e) {
-        return sum + e.size;
-      });
-  stats_.maxSize = maxEvent != events_.end() ? maxEvent->size : 0;
-  stats_.maxTimeBucketAllocationCount = maxCount != data_.rawCounts_.end() ? *maxCount : 0;
+  for (size_t i = first; i < events_.size(); ++i) {
+    if (filtered && sources_[i] != sourceFilter_) {
+      continue;
+    }
+    AccumulateStats(stats_, events_[i]);
+  }
+
+  stats_.maxTimeBucketAllocationCount = size_t(data_.maxCount());
+}
+
+void WaterfallWidget::processCompareData()
+{
+  resetBurstDetector(0.0, 1.0);
+
+  // Usually binned along with the rest of the comparison, unless the time
+  // resolution changed since
+  if (comparison_.difference.numTimeBuckets() != accumulationColumns_) {
+    BinTraceComparison(comparison_, accumulationColumns_, std::thread::hardware_concurrency());
+  }
+  data_ = comparison_.difference;
+  stats_ = comparison_.candidateStats;
 }
 
 void WaterfallWidget::updateVisualization()
@@ -185,19 +498,31 @@ void WaterfallWidget::updateVisualization()
 
   constexpr int statsHeight = 25;
   const int pixmapHeight = height() - statsHeight;
-  const int bucketHeight = std::max(1, pixmapHeight / int(SIZE_BUCKETS.size()));
 
   pixmap_.fill(Qt::black);
 
-  processDataForCurrentSize();
+  // Events are only re-binned when the data itself changes. Resizing just
+  // resamples the fixed resolution histogram to the pixel grid.
+  if (histogramDirty_) {
+    processData();
+    histogramDirty_ = false;
+  }
+
+  // The number of size buckets depends on the mode and the size bucket scheme
+  const int bucketHeight = std::max(1, pixmapHeight / std::max(1, data_.numSizeBuckets()));
+  ResampleTimeBuckets(data_, width(), displayData_);
 
   QPainter painter(&pixmap_);
-  data_.process([&](int x, int y, int count) {
+  displayData_.process([&](int x, int y, int count) {
     y = pixmapHeight - (y + 1) * bucketHeight;
-    const QColor color = getColorForCount(count);
+    const QColor color = compareMode_ ? getColorForDelta(count) : getColorForCount(count);
     painter.fillRect(x, y, 1, bucketHeight, color);
   });
 
+  if (showBursts_ && !compareMode_) {
+    drawBursts(painter, pixmapHeight, bucketHeight);
+  }
+
   update();
 }
 
@@ -227,15 +552,45 @@ void WaterfallWidget::paintEvent(QPaintEvent *event)
       return str;
     };
 
-    const QString statsText =
-        QString(
-            "Total Allocations: %1  |  Total Size: %2 bytes  |  Max Allocation: %3 bytes  |  Max "
-            "Bucket Count: %4  |  Time Bucket: %5 ms")
-            .arg(useThinSpace(stats_.totalAllocations))
-            .arg(useThinSpace(stats_.totalSize))
-            .arg(useThinSpace(stats_.maxSize))
-            .arg(useThinSpace(stats_.maxTimeBucketAllocationCount))
-            .arg(stats_.timeBucketMs, 0, 'f', 2);
+    auto signedDelta = [&](size_t baseline, size_t candidate) {
+      return candidate >= baseline ? "+" + useThinSpace(candidate - baseline) :
+                                     QString(QChar(0x2212)) + useThinSpace(baseline - candidate);
+    };
+
+    QString statsText;
+    if (compareMode_) {
+      const AllocationStats &baselineStats = comparison_.baselineStats;
+      const double baselineCount = double(std::max<size_t>(baselineStats.totalAllocations, 1));
+      const double percent = 100.0 *
+                             (double(stats_.totalAllocations) -
+                              double(baselineStats.totalAllocations)) /
+                             baselineCount;
+      statsText =
+          QString(
+              "Baseline: %1 allocs, %2 bytes  |  Candidate: %3 allocs, %4 bytes  |  Delta: %5 "
+              "allocs (%6%), %7 bytes  |  Max Bucket Count: %8 / %9  |  Time Bucket: %10 ms")
+              .arg(useThinSpace(baselineStats.totalAllocations))
+              .arg(useThinSpace(baselineStats.totalSize))
+              .arg(useThinSpace(stats_.totalAllocations))
+              .arg(useThinSpace(stats_.totalSize))
+              .arg(signedDelta(baselineStats.totalAllocations, stats_.totalAllocations))
+              .arg(percent, 0, 'f', 1)
+              .arg(signedDelta(baselineStats.totalSize, stats_.totalSize))
+              .arg(useThinSpace(baselineStats.maxTimeBucketAllocationCount))
+              .arg(useThinSpace(stats_.maxTimeBucketAllocationCount))
+              .arg(stats_.timeBucketMs, 0, 'f', 2);
+    }
+    else {
+      statsText =
+          QString(
+              "Total Allocations: %1  |  Total Size: %2 bytes  |  Max Allocation: %3 bytes  |  "
+              "Max Bucket Count: %4  |  Time Bucket: %5 ms")
+              .arg(useThinSpace(stats_.totalAllocations))
+              .arg(useThinSpace(stats_.totalSize))
+              .arg(useThinSpace(stats_.maxSize))
+              .arg(useThinSpace(stats_.maxTimeBucketAllocationCount))
+              .arg(stats_.timeBucketMs, 0, 'f', 2);
+    }
 
     painter.drawText(6, graphHeight + 17, statsText);
   }
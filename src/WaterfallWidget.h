@@ -3,53 +3,96 @@
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #pragma once
 
+#include "BurstDetector.h"
 #include "DataSource.h"
+#include "Histogram.h"
+#include "LiveHistogram.h"
+#include "SizeBuckets.h"
+#include "SizeClasses.h"
 
+#include <QPainter>
 #include <QPixmap>
 #include <QWidget>
 
-#include <algorithm>
+#include <cstdint>
 #include <vector>
 
-struct AllocationData {
-  void prepare(int numTimeBuckets, int numSizeBuckets)
+// Length of the time window shown at once
+constexpr double MAX_TIME_WINDOW_MS = 30000.0;
+
+class WaterfallWidget : public QWidget {
+  Q_OBJECT
+
+ public:
+  explicit WaterfallWidget(QWidget *parent = nullptr);
+
+  void setData(const AllocationEvents &events);
+  void setCompareData(TraceComparison comparison);
+  // `lateEventsMs` is how long after the fact the live source may still
+  // deliver events.
+  void setLiveMode(bool enabled, double lateEventsMs = 0.0);
+
+  // Progressive loading: the waterfall fills in as chunks of a trace arrive.
+  // Chunks are binned as they are appended; the whole trace is only re-binned
+  // at the end if its time range turns out to differ from a full window.
+  void beginProgressiveData();
+  void appendData(const AllocationEvents &events, const AllocationSources &sources);
+  void endProgressiveData();
+
+  // Number of time buckets events are binned into, independent of the widget
+  // width. The histogram is resampled to the pixel grid for display.
+  void setAccumulationColumns(int numColumns);
+  int accumulationColumns() const
   {
-    numTimeBuckets_ = numTimeBuckets;
-    numSizeBuckets_ = numSizeBuckets;
-    rawCounts_.resize(size_t(numTimeBuckets) * numSizeBuckets, 0);
-    std::fill(rawCounts_.begin(), rawCounts_.end(), 0);
+    return accumulationColumns_;
   }
 
-  void incrementCount(int timeBucket, int sizeBucket)
+  // Restricts the view to events from one merged source, or all sources when negative.
+  void setSourceFilter(int source);
+
+  // Size buckets for loaded traces and raw live captures. Captures aggregated
+  // at ingest and trace comparisons always use SIZE_BUCKETS.
+  void setSizeBuckets(const SizeBucketScheme &sizeBuckets);
+  const SizeBucketScheme &sizeBuckets() const
   {
-    rawCounts_[size_t(timeBucket) * numSizeBuckets_ + sizeBucket]++;
+    return sizeBuckets_;
   }
-
-  template<typename Fn> void process(Fn &&fn) const
+  // The scheme of the shown histogram and its bursts
+  const SizeBucketScheme &shownSizeBuckets() const
   {
-    for (int t = 0; t < numTimeBuckets_; ++t) {
-      for (int s = 0; s < numSizeBuckets_; ++s) {
-        const int count = rawCounts_[size_t(t) * numSizeBuckets_ + s];
-        if (count > 0) {
-          fn(t, s, count);
-        }
-      }
-    }
+    return liveAggregated_ || compareMode_ ? SizeBucketScheme::Default() : sizeBuckets_;
   }
+  // The shown events, for recommending size classes. It refers to the events
+  // held here, which the next setData, beginProgressiveData, appendData or
+  // setCompareData changes.
+  SizeDistributionQuery sizeDistributionQuery() const;
 
-  int numTimeBuckets_ = 0;
-  int numSizeBuckets_ = 0;
-  std::vector<int> rawCounts_;
-};
-
-class WaterfallWidget : public QWidget {
-  Q_OBJECT
+  bool isCompareMode() const
+  {
+    return compareMode_;
+  }
+  const BucketTotals &baselineTotals() const
+  {
+    return comparison_.baselineTotals;
+  }
+  const BucketTotals &candidateTotals() const
+  {
+    return comparison_.candidateTotals;
+  }
 
- public:
-  explicit WaterfallWidget(QWidget *parent = nullptr);
+  // Bursts found in the current trace, or so far in the live capture. Bursts
+  // are detected on finished time buckets as they complete.
+  const Bookmarks &bookmarks() const
+  {
+    return burstDetector_.bookmarks();
+  }
+  void setShowBursts(bool show);
+  void setBurstThreshold(double threshold);
+  double burstThreshold() const
+  {
+    return burstOptions_.threshold;
+  }
 
-  void setData(const AllocationEvents &events);
-  void setLiveMode(bool enabled);
   QSize sizeHint() const override;
 
   template<typename Fn> void updateLiveData(double timeMs, Fn &&fn)
@@ -59,9 +102,14 @@ class WaterfallWidget : public QWidget {
       return;
     }
     fn(events_);
+    histogramDirty_ = true;
     updateVisualization();
   }
 
+  // Live mode fed by a source that aggregates at ingest. Only finished columns
+  // are read, so the cost is independent of the allocation rate.
+  void updateLiveHistogram(LiveHistogram &histogram, double timeMs);
+
  protected:
   void paintEvent(QPaintEvent *event) override;
   void resizeEvent(QResizeEvent *event) override;
@@ -69,14 +117,50 @@ class WaterfallWidget : public QWidget {
  private:
   void updateVisualization();
   QColor getColorForCount(int count) const;
-  void processDataForCurrentSize();
+  QColor getColorForDelta(int delta) const;
+  void processData();
+  void binEvents(size_t first, const TimeGrid &grid);
+  void processCompareData();
+  void resetBurstDetector(double originMs, double columnMs);
+  void detectBursts(int64_t firstColumn, int first, int last);
+  void drawBursts(QPainter &painter, int pixmapHeight, int bucketHeight) const;
 
   const int StatsHeight = 25;
+  static constexpr int DefaultAccumulationColumns = 4096;
 
   AllocationEvents events_;
-  AllocationData data_;
+  AllocationSources sources_;
+  int sourceFilter_ = -1;
+  SizeBucketScheme sizeBuckets_;
+  // Binned at the accumulation resolution, which can be far finer than the
+  // widget, so most cells are empty
+  SparseAllocationData data_;
+  // data_ resampled to one column per pixel
+  CompactAllocationData displayData_;
+  int accumulationColumns_ = DefaultAccumulationColumns;
+  bool histogramDirty_ = true;
+  // Time range covered by the columns of data_
+  TimeGrid dataGrid_;
   AllocationStats stats_;
   QPixmap pixmap_;
   double currentTimeMs_ = 0.0;
   bool liveMode_ = false;
+  double liveLateEventsMs_ = 0.0;
+  double progressiveStartMs_ = 0.0;
+  bool progressiveLoading_ = false;
+
+  // Finished columns drained from a LiveHistogram, as a ring of the last
+  // window. data_ is rebuilt from it instead of from events_.
+  std::vector<uint32_t> liveColumns_;
+  int64_t liveNewestColumn_ = -1;
+  bool liveAggregated_ = false;
+
+  BurstDetector burstDetector_;
+  BurstDetector::Options burstOptions_;
+  bool showBursts_ = true;
+
+  // Compare mode: both traces live in comparison_ and data_ is a copy of its
+  // candidate minus baseline difference.
+  TraceComparison comparison_;
+  bool compareMode_ = false;
 };
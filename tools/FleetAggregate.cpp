@@ -0,0 +1,621 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+// Combines a directory of CSV traces, e.g. one per host, into one report.
+// Traces are parsed in parallel, one per worker at a time, and streamed into
+// per-worker histograms, so memory depends on the number of workers rather
+// than on the size of the traces. Each trace is aligned to its own first
+// event, and traces without any events are skipped. Writes:
+//   waterfall.ppm  average allocations per trace for each time x size bucket
+//   buckets.csv    per size bucket totals and percentiles across the fleet
+//   traces.csv     per trace totals
+
+#include "CSVDataSource.h"
+#include "ColorMap.h"
+#include "DataSource.h"
+#include "Histogram.h"
+#include "SizeBuckets.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int NUM_SIZE_BUCKETS = int(SIZE_BUCKETS.size());
+// Longest stretch of a trace the rate percentiles cover, in rate windows.
+// Bounds the per-worker memory should a trace contain a stray timestamp.
+constexpr size_t MAX_RATE_CELLS = 256 * 1024;
+
+struct Options {
+  std::filesystem::path inputDir;
+  std::filesystem::path outputDir = "fleet-report";
+  int numThreads = int(std::max(1u, std::thread::hardware_concurrency()));
+  bool recursive = false;
+  // Only the first `windowMs` of each trace, 0 for all of it
+  double windowMs = 0.0;
+  // The waterfall has between half of and `maxColumns` time buckets
+  int maxColumns = 4096;
+  // Cell size for the allocation rate percentiles
+  double rateWindowMs = 1000.0;
+  int bucketHeight = 8;
+  // Average count per trace that maps to the top of the colormap
+  double maxCount = NUM_COLORS;
+};
+
+// Time x size counts that start out at a fine column width and double it,
+// merging neighbouring columns, whenever an event lands past the last column.
+// Memory stays fixed however long the traces are, and histograms that started
+// at the same width merge exactly.
+class AdaptiveHistogram {
+ public:
+  static constexpr double BaseColumnMs = 1.0;
+
+  explicit AdaptiveHistogram(int maxColumns)
+      : maxColumns_(maxColumns), counts_(size_t(maxColumns) * NUM_SIZE_BUCKETS, 0)
+  {
+  }
+
+  void add(double timeMs, int sizeBucket)
+  {
+    while (timeMs / columnMs_ >= maxColumns_) {
+      coarsen();
+    }
+    const int column = int(timeMs / columnMs_);
+    numColumns_ = std::max(numColumns_, column + 1);
+    counts_[size_t(column) * NUM_SIZE_BUCKETS + sizeBucket]++;
+  }
+
+  void merge(AdaptiveHistogram other)
+  {
+    while (other.columnMs_ < columnMs_) {
+      other.coarsen();
+    }
+    while (columnMs_ < other.columnMs_) {
+      coarsen();
+    }
+    for (size_t i = 0; i < size_t(other.numColumns_) * NUM_SIZE_BUCKETS; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    numColumns_ = std::max(numColumns_, other.numColumns_);
+  }
+
+  uint64_t get(int column, int sizeBucket) const
+  {
+    return counts_[size_t(column) * NUM_SIZE_BUCKETS + sizeBucket];
+  }
+
+  double columnMs() const
+  {
+    return columnMs_;
+  }
+
+  int numColumns() const
+  {
+    return numColumns_;
+  }
+
+ private:
+  void coarsen()
+  {
+    const int numColumns = (numColumns_ + 1) / 2;
+    for (int column = 0; column < numColumns; ++column) {
+      for (int bucket = 0; bucket < NUM_SIZE_BUCKETS; ++bucket) {
+        const size_t first = size_t(2 * column) * NUM_SIZE_BUCKETS + bucket;
+        const size_t second = first + NUM_SIZE_BUCKETS;
+        const uint64_t sum = counts_[first] +
+                             (2 * column + 1 < numColumns_ ? counts_[second] : 0);
+        counts_[size_t(column) * NUM_SIZE_BUCKETS + bucket] = sum;
+      }
+    }
+    std::fill(counts_.begin() + ptrdiff_t(numColumns) * NUM_SIZE_BUCKETS, counts_.end(), 0);
+    numColumns_ = numColumns;
+    columnMs_ *= 2.0;
+  }
+
+  int maxColumns_;
+  int numColumns_ = 0;
+  double columnMs_ = BaseColumnMs;
+  std::vector<uint64_t> counts_;
+};
+
+// Mergeable distribution of non-negative counts: exact below 16, then 16
+// steps per power of two, so percentiles are within about 3%.
+class CountDistribution {
+ public:
+  void add(uint64_t value)
+  {
+    bins_[binIndex(value)]++;
+    total_++;
+  }
+
+  void merge(const CountDistribution &other)
+  {
+    for (size_t i = 0; i < bins_.size(); ++i) {
+      bins_[i] += other.bins_[i];
+    }
+    total_ += other.total_;
+  }
+
+  // Nearest rank, `p` in [0, 1]
+  double percentile(double p) const
+  {
+    if (total_ == 0) {
+      return 0.0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p * double(total_))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bins_.size(); ++i) {
+      seen += bins_[i];
+      if (seen >= rank) {
+        return binValue(int(i));
+      }
+    }
+    return binValue(int(bins_.size()) - 1);
+  }
+
+ private:
+  static constexpr int SubBins = 16;
+  static constexpr int SubBits = 4;
+
+  static int binIndex(uint64_t value)
+  {
+    if (value < SubBins) {
+      return int(value);
+    }
+    const int exponent = int(std::bit_width(value)) - 1;
+    const int sub = int(value >> (exponent - SubBits)) & (SubBins - 1);
+    return SubBins + (exponent - SubBits) * SubBins + sub;
+  }
+
+  // Middle of the range of values in a bin
+  static double binValue(int index)
+  {
+    if (index < SubBins) {
+      return double(index);
+    }
+    const int exponent = (index - SubBins) / SubBins + SubBits;
+    const int sub = (index - SubBins) % SubBins;
+    const double width = std::ldexp(1.0, exponent - SubBits);
+    return double(SubBins + sub) * width + (width - 1.0) / 2.0;
+  }
+
+  std::array<uint64_t, SubBins + (64 - SubBits) * SubBins> bins_ = {};
+  uint64_t total_ = 0;
+};
+
+struct TraceResult {
+  std::filesystem::path path;
+  uintmax_t fileBytes = 0;
+  bool ok = false;
+  AllocationStats stats;
+  double durationMs = 0.0;
+  // Events before the first one, past the window or with an invalid time
+  size_t skipped = 0;
+  std::array<uint64_t, NUM_SIZE_BUCKETS> bucketCounts = {};
+  std::array<uint64_t, NUM_SIZE_BUCKETS> bucketBytes = {};
+
+  // Traces that could not be read or have no events in range are skipped in
+  // every part of the report
+  bool used() const
+  {
+    return ok && stats.totalAllocations > 0;
+  }
+
+  const char *status() const
+  {
+    return !ok ? "unreadable" : used() ? "ok" : "empty";
+  }
+};
+
+// Everything one worker accumulates over the traces it processed
+struct WorkerState {
+  explicit WorkerState(int maxColumns) : histogram(maxColumns) {}
+
+  AdaptiveHistogram histogram;
+  std::array<CountDistribution, NUM_SIZE_BUCKETS> rates;
+  // Per rate window counts of the current trace
+  std::vector<std::array<uint32_t, NUM_SIZE_BUCKETS>> traceCells;
+};
+
+static void AggregateTrace(const Options &options,
+                           TraceResult &result,
+                           WorkerState &state,
+                           std::atomic<int64_t> &bytesRead)
+{
+  state.traceCells.clear();
+
+  bool haveFirstTimestamp = false;
+  double firstTimestampMs = 0.0;
+  result.ok = CSVDataSource(result.path).readChunks(
+      CSVDataSource::ChunkSize,
+      [&](const AllocationEvents &chunk) {
+        for (const AllocationEvent &event : chunk) {
+          if (!haveFirstTimestamp) {
+            firstTimestampMs = event.timeMs;
+            haveFirstTimestamp = true;
+          }
+
+          const double timeMs = event.timeMs - firstTimestampMs;
+          if (!std::isfinite(timeMs) || timeMs < 0.0 ||
+              (options.windowMs > 0.0 && timeMs >= options.windowMs)) {
+            result.skipped++;
+            continue;
+          }
+
+          const int sizeBucket = GetSizeBucketIndex(event.size);
+          state.histogram.add(timeMs, sizeBucket);
+
+          const double cell = timeMs / options.rateWindowMs;
+          if (cell < double(MAX_RATE_CELLS)) {
+            if (size_t(cell) >= state.traceCells.size()) {
+              state.traceCells.resize(size_t(cell) + 1, {});
+            }
+            state.traceCells[size_t(cell)][sizeBucket]++;
+          }
+
+          AccumulateStats(result.stats, event);
+          result.bucketCounts[sizeBucket]++;
+          result.bucketBytes[sizeBucket] += event.size;
+          result.durationMs = std::max(result.durationMs, timeMs);
+        }
+        return true;
+      },
+      &bytesRead);
+
+  // Windows without allocations count too, up to the end of the trace
+  for (const auto &cell : state.traceCells) {
+    for (int bucket = 0; bucket < NUM_SIZE_BUCKETS; ++bucket) {
+      state.rates[bucket].add(cell[bucket]);
+    }
+  }
+}
+
+static std::vector<TraceResult> FindTraces(const Options &options)
+{
+  std::vector<TraceResult> traces;
+  auto addFile = [&](const std::filesystem::directory_entry &entry) {
+    if (entry.is_regular_file() && entry.path().extension() == ".csv") {
+      TraceResult trace;
+      trace.path = entry.path();
+      trace.fileBytes = entry.file_size();
+      traces.push_back(std::move(trace));
+    }
+  };
+
+  std::error_code error;
+  if (options.recursive) {
+    using RecursiveIterator = std::filesystem::recursive_directory_iterator;
+    for (const auto &entry : RecursiveIterator(options.inputDir, error)) {
+      addFile(entry);
+    }
+  }
+  else {
+    for (const auto &entry : std::filesystem::directory_iterator(options.inputDir, error)) {
+      addFile(entry);
+    }
+  }
+  if (error) {
+    std::fprintf(stderr,
+                 "Failed to read %s: %s\n",
+                 options.inputDir.string().c_str(),
+                 error.message().c_str());
+  }
+
+  std::sort(traces.begin(), traces.end(), [](const TraceResult &a, const TraceResult &b) {
+    return a.path < b.path;
+  });
+  return traces;
+}
+
+// Nearest rank percentile of already sorted values
+static uint64_t Percentile(const std::vector<uint64_t> &sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  const size_t rank = std::max<size_t>(1, size_t(std::ceil(p * double(sorted.size()))));
+  return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+static bool WriteWaterfall(const std::filesystem::path &filePath,
+                           const Options &options,
+                           const AdaptiveHistogram &histogram,
+                           const std::vector<TraceResult> &traces)
+{
+  const int width = std::max(histogram.numColumns(), 1);
+  const int height = NUM_SIZE_BUCKETS * options.bucketHeight;
+
+  // Average over the traces that were still running in each column, so the
+  // tail of the graph is not faded out by shorter traces.
+  std::vector<int> coverage(size_t(width) + 1, 0);
+  for (const TraceResult &trace : traces) {
+    if (trace.used()) {
+      const int last = std::min(int(trace.durationMs / histogram.columnMs()), width - 1);
+      coverage[0]++;
+      coverage[size_t(last) + 1]--;
+    }
+  }
+  for (int column = 1; column <= width; ++column) {
+    coverage[column] += coverage[column - 1];
+  }
+
+  const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) +
+                             "\n255\n";
+  std::vector<uint8_t> pixels(size_t(width) * height * 3);
+  for (int column = 0; column < histogram.numColumns(); ++column) {
+    if (coverage[column] == 0) {
+      continue;
+    }
+    for (int bucket = 0; bucket < NUM_SIZE_BUCKETS; ++bucket) {
+      const double average = double(histogram.get(column, bucket)) / coverage[column];
+      const ColorRgb color = GetColorForCount(int(average * NUM_COLORS / options.maxCount));
+      // Smallest sizes at the bottom, like the viewer
+      const int top = (NUM_SIZE_BUCKETS - 1 - bucket) * options.bucketHeight;
+      for (int y = top; y < top + options.bucketHeight; ++y) {
+        uint8_t *pixel = &pixels[(size_t(y) * width + column) * 3];
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+      }
+    }
+  }
+
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  file.write(header.data(), std::streamsize(header.size()));
+  file.write(reinterpret_cast<const char *>(pixels.data()), std::streamsize(pixels.size()));
+  return bool(file);
+}
+
+static bool WriteBucketTable(const std::filesystem::path &filePath,
+                             const Options &options,
+                             const std::vector<TraceResult> &traces,
+                             const std::array<CountDistribution, NUM_SIZE_BUCKETS> &rates)
+{
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  // The last size bucket has no upper bound, so its max_bytes is left empty
+  file << "size_bucket, min_bytes, max_bytes, traces, allocations, bytes, "
+          "per_trace_p50, per_trace_p90, per_trace_p99, per_trace_max, "
+          "per_sec_p50, per_sec_p90, per_sec_p99, per_sec_max\n";
+
+  const double perSecond = 1000.0 / options.rateWindowMs;
+  const SizeBucketScheme &sizes = SizeBucketScheme::Default();
+  std::vector<uint64_t> perTrace;
+  char maxBytes[24];
+  char line[320];
+  for (int bucket = 0; bucket < NUM_SIZE_BUCKETS; ++bucket) {
+    perTrace.clear();
+    size_t numTraces = 0;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    for (const TraceResult &trace : traces) {
+      if (!trace.used()) {
+        continue;
+      }
+      perTrace.push_back(trace.bucketCounts[bucket]);
+      numTraces += trace.bucketCounts[bucket] > 0 ? 1 : 0;
+      allocations += trace.bucketCounts[bucket];
+      bytes += trace.bucketBytes[bucket];
+    }
+    std::sort(perTrace.begin(), perTrace.end());
+
+    if (bucket + 1 < NUM_SIZE_BUCKETS) {
+      std::snprintf(maxBytes, sizeof(maxBytes), "%zu", SIZE_BUCKETS[bucket]);
+    }
+    else {
+      maxBytes[0] = '\0';
+    }
+
+    const CountDistribution &rate = rates[bucket];
+    const int length = std::snprintf(line,
+                                     sizeof(line),
+                                     "%d, %zu, %s, %zu, %llu, %llu, %llu, %llu, %llu, %llu, "
+                                     "%.1f, %.1f, %.1f, %.1f\n",
+                                     bucket,
+                                     sizes.minBytes(bucket),
+                                     maxBytes,
+                                     numTraces,
+                                     static_cast<unsigned long long>(allocations),
+                                     static_cast<unsigned long long>(bytes),
+                                     static_cast<unsigned long long>(Percentile(perTrace, 0.5)),
+                                     static_cast<unsigned long long>(Percentile(perTrace, 0.9)),
+                                     static_cast<unsigned long long>(Percentile(perTrace, 0.99)),
+                                     static_cast<unsigned long long>(Percentile(perTrace, 1.0)),
+                                     rate.percentile(0.5) * perSecond,
+                                     rate.percentile(0.9) * perSecond,
+                                     rate.percentile(0.99) * perSecond,
+                                     rate.percentile(1.0) * perSecond);
+    file.write(line, length);
+  }
+  return bool(file);
+}
+
+static bool WriteTraceTable(const std::filesystem::path &filePath,
+                            const std::vector<TraceResult> &traces)
+{
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  file << "file, status, allocations, bytes, max_size, duration_ms, skipped\n";
+
+  char line[160];
+  for (const TraceResult &trace : traces) {
+    const int length = std::snprintf(line,
+                                     sizeof(line),
+                                     ", %s, %zu, %zu, %zu, %.3f, %zu\n",
+                                     trace.status(),
+                                     trace.stats.totalAllocations,
+                                     trace.stats.totalSize,
+                                     trace.stats.maxSize,
+                                     trace.durationMs,
+                                     trace.skipped);
+    file << trace.path.filename().string();
+    file.write(line, length);
+  }
+  return bool(file);
+}
+
+static void PrintUsage(const char *program)
+{
+  std::fprintf(stderr,
+               "Usage: %s DIRECTORY [--output DIR] [--threads N] [--recursive] [--window MS] "
+               "[--columns N] [--rate-window MS] [--bucket-height PX] [--max-count N]\n",
+               program);
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &options)
+{
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--recursive") {
+      options.recursive = true;
+      continue;
+    }
+    if (arg.rfind("--", 0) != 0) {
+      if (!options.inputDir.empty()) {
+        return false;
+      }
+      options.inputDir = arg;
+      continue;
+    }
+
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    if (arg == "--output") {
+      options.outputDir = value;
+    }
+    else if (arg == "--threads") {
+      options.numThreads = std::max(1, std::atoi(value));
+    }
+    else if (arg == "--window") {
+      options.windowMs = std::max(0.0, std::atof(value));
+    }
+    else if (arg == "--columns") {
+      options.maxColumns = std::clamp(std::atoi(value), 2, 1 << 16);
+    }
+    else if (arg == "--rate-window") {
+      options.rateWindowMs = std::max(1.0, std::atof(value));
+    }
+    else if (arg == "--bucket-height") {
+      options.bucketHeight = std::clamp(std::atoi(value), 1, 64);
+    }
+    else if (arg == "--max-count") {
+      options.maxCount = std::max(1.0, std::atof(value));
+    }
+    else {
+      return false;
+    }
+  }
+  return !options.inputDir.empty();
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<TraceResult> traces = FindTraces(options);
+  if (traces.empty()) {
+    std::fprintf(stderr, "No .csv traces in %s\n", options.inputDir.string().c_str());
+    return 1;
+  }
+
+  // Largest traces first so that no worker is left with a big one at the end
+  std::vector<size_t> order(traces.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return traces[a].fileBytes > traces[b].fileBytes;
+  });
+
+  const int numWorkers = std::min(options.numThreads, int(traces.size()));
+  std::vector<WorkerState> workers;
+  workers.reserve(numWorkers);
+  for (int i = 0; i < numWorkers; ++i) {
+    workers.emplace_back(options.maxColumns);
+  }
+
+  std::atomic<size_t> nextTrace = 0;
+  std::atomic<int64_t> bytesRead = 0;
+  std::vector<std::thread> threads;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numWorkers; ++i) {
+    threads.emplace_back([&, i]() {
+      for (size_t next = nextTrace++; next < order.size(); next = nextTrace++) {
+        AggregateTrace(options, traces[order[next]], workers[i], bytesRead);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  const double parseSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  WorkerState &combined = workers.front();
+  for (size_t i = 1; i < workers.size(); ++i) {
+    combined.histogram.merge(std::move(workers[i].histogram));
+    for (int bucket = 0; bucket < NUM_SIZE_BUCKETS; ++bucket) {
+      combined.rates[bucket].merge(workers[i].rates[bucket]);
+    }
+  }
+
+  AllocationStats totals;
+  size_t numUsed = 0;
+  for (const TraceResult &trace : traces) {
+    if (!trace.used()) {
+      std::fprintf(stderr, "Skipped %s trace %s\n", trace.status(), trace.path.string().c_str());
+      continue;
+    }
+    numUsed++;
+    totals.totalAllocations += trace.stats.totalAllocations;
+    totals.totalSize += trace.stats.totalSize;
+    totals.maxSize = std::max(totals.maxSize, trace.stats.maxSize);
+  }
+  if (numUsed == 0) {
+    std::fprintf(stderr, "None of the traces had any events\n");
+    return 1;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(options.outputDir, error);
+  const bool written =
+      WriteWaterfall(options.outputDir / "waterfall.ppm", options, combined.histogram, traces) &&
+      WriteBucketTable(options.outputDir / "buckets.csv", options, traces, combined.rates) &&
+      WriteTraceTable(options.outputDir / "traces.csv", traces);
+  if (!written) {
+    std::fprintf(stderr, "Failed to write the report to %s\n", options.outputDir.string().c_str());
+    return 1;
+  }
+
+  std::printf("%zu of %zu traces (%zu skipped), %zu events, %.1f MB in %.2f s on %d threads: "
+              "%.2f M events/s, %.1f MB/s\n",
+              numUsed,
+              traces.size(),
+              traces.size() - numUsed,
+              totals.totalAllocations,
+              double(bytesRead) / 1e6,
+              parseSeconds,
+              numWorkers,
+              double(totals.totalAllocations) / parseSeconds / 1e6,
+              double(bytesRead) / parseSeconds / 1e6);
+  std::printf("waterfall: %d time buckets of %.0f ms, written to %s\n",
+              std::max(combined.histogram.numColumns(), 1),
+              combined.histogram.columnMs(),
+              options.outputDir.string().c_str());
+  return numUsed == traces.size() ? 0 : 2;
+}
@@ -0,0 +1,225 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+// Load generator for the viewer's socket ingest (Capture > Listen on Socket...).
+// Starts a number of producer connections that stream synthetic allocation
+// events and reports the sustained rate. The viewer's status bar shows the
+// latency from sending a batch to the waterfall being redrawn with it.
+
+#include "IngestProtocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct Options {
+  std::string socketPath = INGEST_DEFAULT_SOCKET_PATH;
+  int numClients = 4;
+  // Total over all clients, 0 for as fast as possible
+  double eventsPerSecond = 0.0;
+  uint32_t batchSize = 4096;
+  double seconds = 10.0;
+};
+
+struct ClientStats {
+  std::atomic<uint64_t> events = 0;
+  std::atomic<uint64_t> batches = 0;
+  std::atomic<uint64_t> writeNs = 0;
+};
+
+static void PrintUsage(const char *program)
+{
+  std::fprintf(stderr,
+               "Usage: %s [--socket PATH] [--clients N] [--rate EVENTS_PER_SEC] [--batch N] "
+               "[--seconds S]\n",
+               program);
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &options)
+{
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    if (arg == "--socket") {
+      options.socketPath = value;
+    }
+    else if (arg == "--clients") {
+      options.numClients = std::max(1, std::atoi(value));
+    }
+    else if (arg == "--rate") {
+      options.eventsPerSecond = std::max(0.0, std::atof(value));
+    }
+    else if (arg == "--batch") {
+      options.batchSize = uint32_t(std::clamp<long>(std::atol(value), 1, INGEST_MAX_BATCH_EVENTS));
+    }
+    else if (arg == "--seconds") {
+      options.seconds = std::max(0.1, std::atof(value));
+    }
+    else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int Connect(const std::string &socketPath)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    return -1;
+  }
+  std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static bool WriteAll(int fd, const char *data, size_t size)
+{
+  while (size > 0) {
+    // A closed viewer fails the send instead of killing the process with SIGPIPE
+    const ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= size_t(written);
+  }
+  return true;
+}
+
+static void RunClient(int fd, int clientIndex, const Options &options, ClientStats &stats)
+{
+  // Log-uniform sizes from 8 bytes to 1 MB cover every size bucket
+  std::mt19937 random(clientIndex);
+  std::uniform_real_distribution<double> logSize(3.0, 20.0);
+
+  std::vector<char> buffer(sizeof(IngestBatchHeader) + options.batchSize * sizeof(IngestEvent));
+  const double clientRate = options.eventsPerSecond / options.numClients;
+  const uint64_t startNs = IngestClockNs();
+  const uint64_t endNs = startNs + uint64_t(options.seconds * 1e9);
+
+  uint64_t sent = 0;
+  for (uint64_t nowNs = startNs; nowNs < endNs; nowNs = IngestClockNs()) {
+    if (clientRate > 0.0) {
+      const uint64_t dueNs = startNs + uint64_t(double(sent) / clientRate * 1e9);
+      if (dueNs > nowNs) {
+        const uint64_t sleepNs = std::min(dueNs - nowNs, endNs - nowNs);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(sleepNs));
+        continue;
+      }
+    }
+
+    // Events of a batch are stamped a nanosecond apart from its send time
+    char *eventData = buffer.data() + sizeof(IngestBatchHeader);
+    IngestEvent *events = reinterpret_cast<IngestEvent *>(eventData);
+    for (uint32_t i = 0; i < options.batchSize; ++i) {
+      events[i].timeOffsetNs = i;
+      events[i].reserved = 0;
+      events[i].size = uint64_t(std::exp2(logSize(random)));
+    }
+
+    IngestBatchHeader header{};
+    header.magic = INGEST_BATCH_MAGIC;
+    header.count = options.batchSize;
+    header.baseTimeNs = IngestClockNs();
+    header.sendTimeNs = header.baseTimeNs;
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    if (!WriteAll(fd, buffer.data(), buffer.size())) {
+      std::fprintf(stderr, "Client %d: write failed: %s\n", clientIndex, std::strerror(errno));
+      return;
+    }
+
+    sent += options.batchSize;
+    stats.events += options.batchSize;
+    stats.batches += 1;
+    stats.writeNs += IngestClockNs() - header.sendTimeNs;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<int> fds;
+  for (int i = 0; i < options.numClients; ++i) {
+    const int fd = Connect(options.socketPath);
+    if (fd < 0) {
+      std::fprintf(stderr,
+                   "Failed to connect to %s: %s\n",
+                   options.socketPath.c_str(),
+                   std::strerror(errno));
+      return 1;
+    }
+    fds.push_back(fd);
+  }
+
+  ClientStats stats;
+  std::vector<std::thread> clients;
+  for (int i = 0; i < options.numClients; ++i) {
+    clients.emplace_back(RunClient, fds[i], i, std::cref(options), std::ref(stats));
+  }
+
+  const uint64_t startNs = IngestClockNs();
+  uint64_t lastEvents = 0;
+  for (int second = 1; second <= int(options.seconds); ++second) {
+    std::this_thread::sleep_until(std::chrono::steady_clock::now() + std::chrono::seconds(1));
+    const uint64_t events = stats.events;
+    std::printf("%3d s: %.2f M events/s\n", second, double(events - lastEvents) / 1e6);
+    lastEvents = events;
+  }
+
+  for (std::thread &client : clients) {
+    client.join();
+  }
+  for (const int fd : fds) {
+    close(fd);
+  }
+
+  const double elapsedSeconds = double(IngestClockNs() - startNs) / 1e9;
+  const uint64_t batches = std::max<uint64_t>(stats.batches, 1);
+  std::printf("%d clients sent %llu events in %.2f s: %.2f M events/s, %.1f MB/s, "
+              "%.1f us per batch write\n",
+              options.numClients,
+              static_cast<unsigned long long>(stats.events.load()),
+              elapsedSeconds,
+              double(stats.events) / elapsedSeconds / 1e6,
+              double(stats.batches) *
+                  (sizeof(IngestBatchHeader) + options.batchSize * sizeof(IngestEvent)) /
+                  elapsedSeconds / 1e6,
+              double(stats.writeNs) / batches / 1e3);
+  return 0;
+}
@@ -0,0 +1,249 @@
+/* SPDX-FileCopyrightText: 2026 Jesse Yurkovich
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+// Recommends pool allocator size classes from one or more CSV traces. The
+// exact size distribution is counted while the traces are parsed, then the
+// optimal classes are computed for every class count up to --classes and the
+// wasted bytes of each are listed, next to those of the fixed SIZE_BUCKETS.
+// --output writes the chosen classes in the format the viewer loads with
+// View > Load Size Classes....
+
+#include "CSVDataSource.h"
+#include "Histogram.h"
+#include "SizeBuckets.h"
+#include "SizeClasses.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Options {
+  std::vector<std::filesystem::path> filePaths;
+  // Range of each trace to analyze, relative to its first event
+  double fromMs = 0.0;
+  double toMs = std::numeric_limits<double>::infinity();
+  SizeClassOptions classes;
+  // Class count written to --output, 0 for the largest
+  int chosenClasses = 0;
+  std::filesystem::path outputPath;
+};
+
+static void PrintUsage(const char *program)
+{
+  std::fprintf(stderr,
+               "Usage: %s TRACE.csv [TRACE.csv...] [--from MS] [--to MS] [--classes N] "
+               "[--alignment BYTES] [--max-size BYTES] [--choose N] [--output FILE]\n",
+               program);
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &options)
+{
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--", 0) != 0) {
+      options.filePaths.push_back(arg);
+      continue;
+    }
+
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    if (arg == "--from") {
+      options.fromMs = std::atof(value);
+    }
+    else if (arg == "--to") {
+      options.toMs = std::atof(value);
+    }
+    else if (arg == "--classes") {
+      options.classes.maxClasses = std::clamp(std::atoi(value), 1, 1024);
+    }
+    else if (arg == "--alignment") {
+      options.classes.alignment = size_t(std::max(1ll, std::atoll(value)));
+    }
+    else if (arg == "--max-size") {
+      options.classes.maxPooledSize = size_t(std::max(0ll, std::atoll(value)));
+    }
+    else if (arg == "--choose") {
+      options.chosenClasses = std::max(1, std::atoi(value));
+    }
+    else if (arg == "--output") {
+      options.outputPath = value;
+    }
+    else {
+      return false;
+    }
+  }
+  if (options.filePaths.empty()) {
+    return false;
+  }
+
+  // The viewer only loads as many classes as it has size buckets for
+  constexpr int MaxWrittenClasses = SizeBucketScheme::MaxSize - 1;
+  if (!options.outputPath.empty() && options.classes.maxClasses > MaxWrittenClasses) {
+    std::fprintf(stderr,
+                 "--classes is limited to %d with --output, the most the viewer can load\n",
+                 MaxWrittenClasses);
+    options.classes.maxClasses = MaxWrittenClasses;
+  }
+  return true;
+}
+
+// Counts the sizes in one trace, with its byte range split across up to
+// `builders.size()` threads, each counting into its own builder.
+static bool CountSizes(const Options &options,
+                       const std::filesystem::path &filePath,
+                       std::vector<SizeDistributionBuilder> &builders)
+{
+  const CSVDataSource source(filePath);
+
+  // The range is relative to the first event of the whole trace, which every
+  // thread needs before it starts
+  bool haveFirstTimestamp = false;
+  double firstTimestampMs = 0.0;
+  const bool readToEnd = source.readChunks(1, [&](const AllocationEvents &chunk) {
+    firstTimestampMs = chunk.front().timeMs;
+    haveFirstTimestamp = true;
+    return false;
+  });
+  if (!haveFirstTimestamp) {
+    // Unreadable, or read to the end without finding any events
+    return readToEnd;
+  }
+
+  // Bytes stand in for events when slicing: even the smallest slice holds
+  // tens of thousands of lines
+  std::error_code error;
+  const uintmax_t size = std::filesystem::file_size(filePath, error);
+  const size_t fileBytes = error ? 0 : size_t(size);
+  const unsigned numSlices = EventSliceCount(fileBytes, unsigned(builders.size()));
+  std::vector<char> sliceOk(numSlices, 0);
+  ForEachEventSlice(fileBytes, numSlices, [&](unsigned slice, size_t first, size_t last) {
+    // The last slice also takes whatever was appended since file_size
+    const int64_t lastByte = slice + 1 < numSlices ?
+                                 int64_t(last) :
+                                 std::numeric_limits<int64_t>::max();
+    SizeDistributionBuilder &builder = builders[slice];
+    sliceOk[slice] = source.readRange(
+        int64_t(first), lastByte, CSVDataSource::ChunkSize, [&](const AllocationEvents &chunk) {
+          for (const AllocationEvent &event : chunk) {
+            const double timeMs = event.timeMs - firstTimestampMs;
+            if (timeMs >= options.fromMs && timeMs <= options.toMs) {
+              builder.add(event.size);
+            }
+          }
+          return true;
+        });
+  });
+  return std::find(sliceOk.begin(), sliceOk.end(), 0) == sliceOk.end();
+}
+
+static std::string FormatBytes(uint64_t bytes)
+{
+  char text[32];
+  if (bytes >= uint64_t(1) << 30) {
+    std::snprintf(text, sizeof(text), "%.2f GB", double(bytes) / double(uint64_t(1) << 30));
+  }
+  else if (bytes >= uint64_t(1) << 20) {
+    std::snprintf(text, sizeof(text), "%.2f MB", double(bytes) / double(uint64_t(1) << 20));
+  }
+  else if (bytes >= uint64_t(1) << 10) {
+    std::snprintf(text, sizeof(text), "%.2f KB", double(bytes) / double(uint64_t(1) << 10));
+  }
+  else {
+    std::snprintf(text, sizeof(text), "%llu B", static_cast<unsigned long long>(bytes));
+  }
+  return text;
+}
+
+static double Percent(uint64_t part, uint64_t whole)
+{
+  return whole > 0 ? 100.0 * double(part) / double(whole) : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // Parsing is most of the work, so each trace is split across all threads
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<SizeDistributionBuilder> builders(std::max(1u, std::thread::hardware_concurrency()));
+  for (const std::filesystem::path &filePath : options.filePaths) {
+    if (!CountSizes(options, filePath, builders)) {
+      return 1;
+    }
+  }
+  for (size_t i = 1; i < builders.size(); ++i) {
+    builders[0].merge(builders[i]);
+  }
+  const SizeDistribution distribution = builders[0].finish();
+  const auto counted = std::chrono::steady_clock::now();
+
+  const SizeClassRecommendation recommendation = RecommendSizeClasses(distribution,
+                                                                      options.classes);
+  const auto solved = std::chrono::steady_clock::now();
+
+  if (recommendation.plans.empty()) {
+    std::fprintf(stderr, "No allocations in the selected range\n");
+    return 1;
+  }
+
+  std::printf("%llu requests, %s, %zu distinct sizes (counted in %.2f s, solved in %.2f s)\n",
+              static_cast<unsigned long long>(distribution.totalCount()),
+              FormatBytes(distribution.totalBytes()).c_str(),
+              distribution.sizes.size(),
+              std::chrono::duration<double>(counted - start).count(),
+              std::chrono::duration<double>(solved - counted).count());
+  if (recommendation.unpooledCount > 0) {
+    std::printf("%llu requests, %s above --max-size are not pooled\n",
+                static_cast<unsigned long long>(recommendation.unpooledCount),
+                FormatBytes(recommendation.unpooledBytes).c_str());
+  }
+  if (recommendation.alignment != options.classes.alignment) {
+    std::printf("Too many distinct sizes, alignment raised to %zu bytes\n",
+                recommendation.alignment);
+  }
+
+  // Requests beyond the largest fixed bucket are not counted for it
+  const uint64_t fixedWaste = WastedBytes(
+      distribution, SizeBucketScheme::Default().limits(), options.classes.maxPooledSize);
+  std::printf("\nSIZE_BUCKETS (%d classes): %s wasted, %.2f%% of the pooled bytes\n\n",
+              SizeBucketScheme::Default().size() - 1,
+              FormatBytes(fixedWaste).c_str(),
+              Percent(fixedWaste, recommendation.pooledBytes));
+
+  std::printf("classes  wasted bytes      %% of pooled\n");
+  for (size_t n = 1; n <= recommendation.plans.size(); ++n) {
+    const SizeClassPlan &plan = recommendation.plans[n - 1];
+    std::printf("%7zu  %-16s  %6.2f%%\n",
+                n,
+                FormatBytes(plan.wastedBytes).c_str(),
+                Percent(plan.wastedBytes, recommendation.pooledBytes));
+  }
+
+  const size_t chosen = options.chosenClasses > 0 ?
+                            std::min(size_t(options.chosenClasses), recommendation.plans.size()) :
+                            recommendation.plans.size();
+  const SizeClassPlan &plan = recommendation.plans[chosen - 1];
+  std::printf("\n%zu classes:", chosen);
+  for (const size_t limit : plan.limits) {
+    std::printf(" %zu", limit);
+  }
+  std::printf("\n");
+
+  if (!options.outputPath.empty() && !WriteSizeClasses(options.outputPath, plan.limits)) {
+    return 1;
+  }
+  return 0;
+}